@@ -1,10 +1,13 @@
 #include <juce_audio_devices/juce_audio_devices.h>
 #include <juce_audio_formats/juce_audio_formats.h>
 #include "AudioEngine.h"
+#include "RealtimeSafety.h"
+#include <cstring>
+#include <utility>
 
 AudioEngine::AudioEngine()
 {
-    juce::addDefaultFormatsToManager(pluginFormatManager);
+    addOverloadSteps();
 }
 
 AudioEngine::~AudioEngine()
@@ -12,54 +15,290 @@ AudioEngine::~AudioEngine()
     shutdown();
 }
 
-void AudioEngine::initialize()
+void AudioEngine::initialize(const juce::AudioDeviceManager::AudioDeviceSetup* preferredSetup)
 {
-    deviceManager.initialiseWithDefaultDevices(1, 1);
+    if (pluginFormatManager.getNumFormats() == 0)
+        juce::addDefaultFormatsToManager(pluginFormatManager);
+    
+    // Ask for as many channels as the chain can run; the device opens what
+    // it has and audioDeviceAboutToStart sizes the chain from that.
+    auto open = [this](const juce::AudioDeviceManager::AudioDeviceSetup* setup)
+    {
+        return deviceManager.initialise(maxProcessChannels, maxProcessChannels, nullptr, true, {}, setup);
+    };
+    
+    // A preferred setup goes straight to setAudioDeviceSetup, with no
+    // fallback of JUCE's own. A saved device may have been unplugged or
+    // renamed, or stopped taking the saved rate or buffer size, so step back
+    // to its default rate and buffer size, then to the default devices.
+    auto error = open(preferredSetup);
+    if (error.isNotEmpty() && preferredSetup != nullptr)
+    {
+        juce::Logger::writeToLog("Couldn't open the saved audio setup (" + error + "), trying its default rate and buffer size");
+        auto devicesOnly = *preferredSetup;
+        devicesOnly.sampleRate = 0.0;
+        devicesOnly.bufferSize = 0;
+        error = open(&devicesOnly);
+        
+        if (error.isNotEmpty())
+        {
+            juce::Logger::writeToLog("Couldn't open the saved audio devices (" + error + "), using the defaults");
+            error = open(nullptr);
+        }
+    }
+    if (error.isNotEmpty())
+        juce::Logger::writeToLog("Couldn't open an audio device: " + error);
+    
     deviceManager.addAudioCallback(this);
+    initialized.store(true);
+    
+    realtimeTuning.lockMemory();
+    realtimeTuning.pinWorkerThread(noiseSuppressor.getThreadId(), "noise profile worker");
+    realtimeTuning.pinWorkerThread(linearPhaseEQ.getThreadId(), "linear-phase EQ worker");
+    overloadGovernor.setEnabled(overloadGovernorEnabled);
+    
+    juce::Logger::writeToLog("DSP kernels: " + juce::String(kernels.name));
+}
+
+void AudioEngine::initializeAsync(const juce::AudioDeviceManager::AudioDeviceSetup& preferredSetup,
+                                  std::function<void()> onReady)
+{
+    // Registering is cheap, and done here the formats are there for the
+    // message thread (plugin loads and restores) while the device opens.
+    if (pluginFormatManager.getNumFormats() == 0)
+        juce::addDefaultFormatsToManager(pluginFormatManager);
+    
+    juce::WeakReference<AudioEngine> weakThis(this);
+    
+    initThread = std::thread([this, weakThis, preferredSetup, onReady] {
+        // WASAPI and DirectSound enumerate and open devices through COM.
+        const ScopedComInitialiser com;
+        initialize(&preferredSetup);
+        
+        juce::MessageManager::callAsync([weakThis, onReady] {
+            if (weakThis != nullptr && onReady)
+                onReady();
+        });
+    });
+}
+
+void AudioEngine::useVirtualDevice(const VirtualAudioIODeviceType::Options& options)
+{
+    // Registered before the manager creates its platform types, so it ends
+    // up as the only backend.
+    deviceManager.addAudioDeviceType(std::make_unique<VirtualAudioIODeviceType>(options));
+    deviceManager.setCurrentAudioDeviceType(VirtualAudioIODeviceType::typeName, false);
+    deviceRegistry.addDeviceType(std::make_unique<VirtualAudioIODeviceType>(options));
+    usingVirtualDevice = true;
+    
+    // Free-running renders must come out the same however long blocks take.
+    if (options.pace == 0.0)
+        overloadGovernorEnabled = false;
 }
 
 void AudioEngine::shutdown()
 {
+    if (initThread.joinable())
+        initThread.join();
+    
+    overloadGovernor.setEnabled(false);
     deviceManager.removeAudioCallback(this);
     deviceManager.closeAudioDevice();
+    
+    if (pluginInstance != nullptr)
+        pluginInstance->releaseResources();
+    isPrepared = false;
 }
 
 void AudioEngine::audioDeviceAboutToStart(juce::AudioIODevice* device)
 {
-    currentSampleRate = device->getCurrentSampleRate();
-    auto bufferSize = device->getCurrentBufferSizeSamples();
+    deviceBufferSize = device->getCurrentBufferSizeSamples();
+    runningDevice = device;
+    realtimeTuning.deviceStarting();
     
-    pluginBuffer.setSize(2, bufferSize);
+    const int activeInputs = device->getActiveInputChannels().countNumberOfSetBits();
+    prepareProcessing(device->getCurrentSampleRate(), getProcessingBlockSize(),
+                      juce::jlimit(2, maxProcessChannels, activeInputs));
+    prefaultBuffers();
     
-    juce::dsp::ProcessSpec spec;
-    spec.sampleRate = currentSampleRate;
-    spec.maximumBlockSize = (juce::uint32)bufferSize;
-    spec.numChannels = 1;
+    // Whatever was playing before the switch faded out; fade back in.
+    fadeState.store(fadingIn);
+}
+
+void AudioEngine::audioDeviceStopped()
+{
+    runningDevice = nullptr;
     
-    bassFilterL.prepare(spec);
-    bassFilterR.prepare(spec);
-    midFilterL.prepare(spec);
-    midFilterR.prepare(spec);
-    trebleFilterL.prepare(spec);
-    trebleFilterR.prepare(spec);
+    // Processing state is deliberately kept: a device switch at the same
+    // rate and block size resumes where it left off, and heavy plugins
+    // aren't torn down. Everything is released in shutdown().
+}
+
+int AudioEngine::getProcessingBlockSize() const
+{
+    const int requested = internalBlockSize.load();
+    return requested > 0 ? requested : deviceBufferSize;
+}
+
+void AudioEngine::setInternalBlockSize(int blockSize)
+{
+    const juce::ScopedLock sl(deviceManager.getAudioCallbackLock());
+    internalBlockSize.store(juce::jmax(0, blockSize));
     
-    updateEQFilters();
+    // Force the scheduler to restart even if the chain doesn't need it.
+    schedulerBlockSize = -1;
+    if (isPrepared)
+        prepareProcessing(currentSampleRate, getProcessingBlockSize(), numProcessChannels);
+    prefaultBuffers();
+}
+
+void AudioEngine::prefaultBuffers()
+{
+    if (!realtimeTuning.isEnabled())
+        return;
     
-    if (pluginInstance != nullptr)
-        pluginInstance->prepareToPlay(currentSampleRate, bufferSize);
+    realtimeTuning.prefault(pluginBuffer);
+    realtimeTuning.prefault(linearPhaseBuffer);
+    realtimeTuning.prefault(schedulerInput);
+    realtimeTuning.prefault(schedulerOutput);
 }
 
-void AudioEngine::audioDeviceStopped()
+void AudioEngine::prepareProcessing(double sampleRate, int blockSize, int numChannels)
 {
-    bassFilterL.reset();
-    bassFilterR.reset();
-    midFilterL.reset();
-    midFilterR.reset();
-    trebleFilterL.reset();
-    trebleFilterR.reset();
+    const bool rateChanged = sampleRate != currentSampleRate || !isPrepared;
+    const bool blockGrew = blockSize > currentBufferSize || !isPrepared;
+    const bool channelsChanged = numChannels != numProcessChannels || !isPrepared;
+    const int newSchedulerBlockSize = internalBlockSize.load();
     
-    if (pluginInstance != nullptr)
-        pluginInstance->releaseResources();
+    if (newSchedulerBlockSize != schedulerBlockSize || channelsChanged)
+    {
+        schedulerBlockSize = newSchedulerBlockSize;
+        schedulerInput.setSize(numChannels, 2 * juce::jmax(1, schedulerBlockSize));
+        schedulerOutput.setSize(numChannels, 2 * juce::jmax(1, schedulerBlockSize));
+        schedulerInputCount = 0;
+        schedulerOutputCount = 0;
+        schedulerBuffered = false;
+    }
+    
+    if (!rateChanged && !blockGrew && !channelsChanged)
+        return;
+    
+    currentSampleRate = sampleRate;
+    currentBufferSize = juce::jmax(blockSize, isPrepared ? currentBufferSize : 0);
+    numProcessChannels = numChannels;
+    chainChannelVariant = numChannels == 2 ? 0 : numChannels == 8 ? 1 : 2;
+    isPrepared = true;
+    
+    pluginBuffer.setSize(numChannels, currentBufferSize);
+    linearPhaseBuffer.setSize(numChannels, currentBufferSize);
+    
+    if (blockGrew || channelsChanged)
+        toneFilters.prepare(numChannels, currentBufferSize);
+    
+    // Stages that only depend on the sample rate and channel count.
+    if (rateChanged || channelsChanged)
+    {
+        updateEQFilters(liveTone);
+        
+        loudnessMeter.prepare(currentSampleRate, numChannels);
+        noiseSuppressor.prepare(currentSampleRate, numChannels);
+    }
+    
+    // Stages with block-sized state.
+    juce::dsp::ProcessSpec convolutionSpec;
+    convolutionSpec.sampleRate = currentSampleRate;
+    convolutionSpec.maximumBlockSize = (juce::uint32)currentBufferSize;
+    convolutionSpec.numChannels = (juce::uint32)numChannels;
+    irConvolution.prepare(convolutionSpec);
+    linearPhaseEQ.prepare(convolutionSpec);
+    linearPhaseRunning = false;
+    linearPhaseOutput = false;
+    linearPhaseSwapGain = 1.0f;
+    
+    clipperOversampler.prepare(numChannels, currentBufferSize);
+    pluginOversampler.prepare(numChannels, currentBufferSize);
+    mixer.prepare(currentSampleRate, currentBufferSize, numChannels);
+    
+    // Neither end resamples, so both follow the device rate.
+    if (rateChanged)
+    {
+        networkSender.prepare(currentSampleRate);
+        networkReceiver.setSampleRate(currentSampleRate);
+    }
+    
+    preparePlugin();
+}
+
+void AudioEngine::fadeOutForDeviceChange()
+{
+    if (!initialized.load())
+        return;
+    
+    auto* device = deviceManager.getCurrentAudioDevice();
+    if (device == nullptr || !device->isPlaying())
+        return;
+    
+    switchStartMs.store(juce::Time::getMillisecondCounterHiRes());
+    fadeState.store(fadingOut);
+    
+    // The callback ramps to silence within one buffer; allow a few.
+    const double bufferMs = 1000.0 * device->getCurrentBufferSizeSamples() / device->getCurrentSampleRate();
+    const auto deadline = juce::Time::getMillisecondCounterHiRes() + 3.0 * bufferMs + 5.0;
+    while (fadeState.load() != silent && juce::Time::getMillisecondCounterHiRes() < deadline)
+        juce::Thread::sleep(1);
+}
+
+void AudioEngine::switchWithFade(const std::function<void()>& change)
+{
+    const juce::ScopedLock sl(switchLock);
+    
+    // The init thread owns the device manager until it is done; switch
+    // without a fade in the meantime.
+    auto* device = initialized.load() ? deviceManager.getCurrentAudioDevice() : nullptr;
+    if (device == nullptr || !device->isPlaying())
+    {
+        change();
+        return;
+    }
+    
+    // Same fade as a device switch, without counting towards its gap figure.
+    fadeState.store(fadingOut);
+    const double bufferMs = 1000.0 * device->getCurrentBufferSizeSamples() / device->getCurrentSampleRate();
+    const auto deadline = juce::Time::getMillisecondCounterHiRes() + 3.0 * bufferMs + 5.0;
+    while (fadeState.load() != silent && juce::Time::getMillisecondCounterHiRes() < deadline)
+        juce::Thread::sleep(1);
+    
+    change();
+    
+    int expected = silent;
+    fadeState.compare_exchange_strong(expected, fadingIn);
+}
+
+void AudioEngine::applyDeviceFade(int numSamples)
+{
+    const int state = fadeState.load();
+    if (state == running)
+        return;
+    
+    if (state == silent)
+    {
+        pluginBuffer.clear(0, numSamples);
+        return;
+    }
+    
+    const float startGain = state == fadingIn ? 0.0f : 1.0f;
+    for (int ch = 0; ch < pluginBuffer.getNumChannels(); ++ch)
+        kernels.applyGainRamp(pluginBuffer.getWritePointer(ch), numSamples, startGain, 1.0f - startGain);
+    
+    if (state == fadingIn)
+    {
+        const double start = switchStartMs.exchange(0.0);
+        if (start > 0.0)
+            lastSwitchGapMs.store((float)(juce::Time::getMillisecondCounterHiRes() - start));
+    }
+    
+    int expected = state;
+    fadeState.compare_exchange_strong(expected, state == fadingIn ? running : silent);
 }
 
 void AudioEngine::audioDeviceIOCallbackWithContext(
@@ -70,73 +309,185 @@ void AudioEngine::audioDeviceIOCallbackWithContext(
     int numSamples,
     const juce::AudioIODeviceCallbackContext& context)
 {
+    const RealtimeSafety::ScopedRealtimeSection realtimeSection;
+    
+    // Flush-to-zero for every stage in the callback, the plugin included;
+    // the IIR and oversampling filters otherwise decay into denormals as
+    // soon as the mic goes quiet.
+    const juce::ScopedNoDenormals noDenormals;
+    realtimeTuning.onAudioThread();
+    const OverloadGovernor::ScopedBlockTimer blockTimer(overloadGovernor, numSamples, currentSampleRate);
+    juce::ignoreUnused(context);
+    
+    // Published on every way out of the callback, timing included.
+    const auto callbackStartTicks = metricsPublisher.isOpen() ? juce::Time::getHighResolutionTicks() : 0;
+    const juce::ScopeGuard publishOnExit { [&] { publishMetrics(numSamples, callbackStartTicks); } };
+    
+    if (firstAudioTimeMs.load(std::memory_order_relaxed) == 0.0)
+        firstAudioTimeMs.store(juce::Time::getMillisecondCounterHiRes());
+    
     for (int i = 0; i < numOutputChannels; ++i)
     {
         if (outputChannelData[i] != nullptr)
             juce::FloatVectorOperations::clear(outputChannelData[i], numSamples);
     }
     
-    if (numInputChannels == 0 || inputChannelData[0] == nullptr)
-        return;
+    numInputChannels = juce::jmin(numInputChannels, maxDeviceChannels);
+    numOutputChannels = juce::jmin(numOutputChannels, maxDeviceChannels);
     
-    for (int ch = 0; ch < juce::jmin(numInputChannels, pluginBuffer.getNumChannels()); ++ch)
-    {
-        juce::FloatVectorOperations::copy(pluginBuffer.getWritePointer(ch), 
-                                         inputChannelData[ch], 
-                                         numSamples);
-    }
+    const float* inputs[maxDeviceChannels];
+    float* outputs[maxDeviceChannels];
     
-    if (numInputChannels == 1 && pluginBuffer.getNumChannels() > 1)
+    // Follow the device: just make sure no chunk exceeds what the chain was
+    // prepared for, whatever the driver hands us.
+    if (schedulerBlockSize == 0)
     {
-        juce::FloatVectorOperations::copy(pluginBuffer.getWritePointer(1),
-                                         pluginBuffer.getReadPointer(0),
-                                         numSamples);
+        for (int pos = 0; pos < numSamples; pos += currentBufferSize)
+        {
+            const int n = juce::jmin(currentBufferSize, numSamples - pos);
+            for (int ch = 0; ch < numInputChannels; ++ch)
+                inputs[ch] = inputChannelData[ch] != nullptr ? inputChannelData[ch] + pos : nullptr;
+            for (int ch = 0; ch < numOutputChannels; ++ch)
+                outputs[ch] = outputChannelData[ch] != nullptr ? outputChannelData[ch] + pos : nullptr;
+            
+            processChunk(inputs, numInputChannels, outputs, numOutputChannels, n);
+        }
+        return;
     }
     
-    float inLevel = 0.0f;
-    for (int ch = 0; ch < pluginBuffer.getNumChannels(); ++ch)
-        inLevel = juce::jmax(inLevel, pluginBuffer.getMagnitude(ch, 0, numSamples));
-    inputLevel.store(inLevel);
+    const int blockSize = schedulerBlockSize;
     
-    for (int ch = 0; ch < pluginBuffer.getNumChannels(); ++ch)
+    if (!schedulerBuffered && numSamples % blockSize != 0)
     {
-        juce::FloatVectorOperations::multiply(pluginBuffer.getWritePointer(ch), 
-                                             currentGain, 
-                                             numSamples);
+        // First misaligned callback: switch to the FIFO path for good, with
+        // one block of latency primed as silence.
+        schedulerBuffered = true;
+        schedulerInputCount = 0;
+        schedulerOutputCount = blockSize;
+        schedulerOutput.clear();
     }
     
-    if (pluginBuffer.getNumChannels() >= 1)
+    // Aligned driver blocks are processed in place, block by block.
+    if (!schedulerBuffered)
     {
-        auto* dataL = pluginBuffer.getWritePointer(0);
-        for (int i = 0; i < numSamples; ++i)
+        for (int pos = 0; pos < numSamples; pos += blockSize)
         {
-            dataL[i] = bassFilterL.processSample(dataL[i]);
-            dataL[i] = midFilterL.processSample(dataL[i]);
-            dataL[i] = trebleFilterL.processSample(dataL[i]);
+            for (int ch = 0; ch < numInputChannels; ++ch)
+                inputs[ch] = inputChannelData[ch] != nullptr ? inputChannelData[ch] + pos : nullptr;
+            for (int ch = 0; ch < numOutputChannels; ++ch)
+                outputs[ch] = outputChannelData[ch] != nullptr ? outputChannelData[ch] + pos : nullptr;
+            
+            processChunk(inputs, numInputChannels, outputs, numOutputChannels, blockSize);
         }
+        return;
     }
-    if (pluginBuffer.getNumChannels() >= 2)
+    
+    // Anything else goes through input/output FIFOs of two blocks each. The
+    // output side starts one block ahead, so in + out always equals one
+    // block and neither can overflow or underrun.
+    const int fifoChannels = schedulerInput.getNumChannels();
+    const int usedInputs = juce::jmin(numInputChannels, fifoChannels);
+    
+    for (int pos = 0; pos < numSamples;)
     {
-        auto* dataR = pluginBuffer.getWritePointer(1);
-        for (int i = 0; i < numSamples; ++i)
+        const int n = juce::jmin(blockSize, numSamples - pos);
+        
+        for (int ch = 0; ch < usedInputs; ++ch)
+        {
+            if (inputChannelData[ch] != nullptr)
+                schedulerInput.copyFrom(ch, schedulerInputCount, inputChannelData[ch] + pos, n);
+            else
+                schedulerInput.clear(ch, schedulerInputCount, n);
+        }
+        schedulerInputCount += n;
+        
+        if (schedulerInputCount >= blockSize)
         {
-            dataR[i] = bassFilterR.processSample(dataR[i]);
-            dataR[i] = midFilterR.processSample(dataR[i]);
-            dataR[i] = trebleFilterR.processSample(dataR[i]);
+            for (int ch = 0; ch < usedInputs; ++ch)
+                inputs[ch] = schedulerInput.getReadPointer(ch);
+            for (int ch = 0; ch < fifoChannels; ++ch)
+                outputs[ch] = schedulerOutput.getWritePointer(ch, schedulerOutputCount);
+            
+            processChunk(inputs, usedInputs, outputs, fifoChannels, blockSize);
+            schedulerOutputCount += blockSize;
+            
+            schedulerInputCount -= blockSize;
+            for (int ch = 0; ch < usedInputs; ++ch)
+                std::memmove(schedulerInput.getWritePointer(ch), schedulerInput.getReadPointer(ch, blockSize),
+                             sizeof(float) * (size_t)schedulerInputCount);
         }
+        
+        for (int ch = 0; ch < juce::jmin(numOutputChannels, fifoChannels); ++ch)
+        {
+            if (outputChannelData[ch] != nullptr)
+                juce::FloatVectorOperations::copy(outputChannelData[ch] + pos, schedulerOutput.getReadPointer(ch), n);
+        }
+        
+        schedulerOutputCount -= n;
+        for (int ch = 0; ch < fifoChannels; ++ch)
+            std::memmove(schedulerOutput.getWritePointer(ch), schedulerOutput.getReadPointer(ch, n),
+                         sizeof(float) * (size_t)schedulerOutputCount);
+        
+        pos += n;
+    }
+}
+
+void AudioEngine::processChunk(const float* const* inputChannelData,
+                               int numInputChannels,
+                               float* const* outputChannelData,
+                               int numOutputChannels,
+                               int numSamples)
+{
+    for (int i = 0; i < numOutputChannels; ++i)
+    {
+        if (outputChannelData[i] != nullptr)
+            juce::FloatVectorOperations::clear(outputChannelData[i], numSamples);
     }
     
-    if (pluginInstance != nullptr)
+    if (numInputChannels == 0 || inputChannelData[0] == nullptr)
+        return;
+    
+    updateTone(numSamples);
+    
+    const bool autoGain = autoGainEnabled.load();
+    if (autoGain && !autoGainWasEnabled)
+        autoGainDb = liveTone.boostDb;
+    autoGainWasEnabled = autoGain;
+    
+    const float targetGain = juce::Decibels::decibelsToGain(autoGain ? autoGainDb : liveTone.boostDb);
+    
+    if (linearPhaseRequested.load() && !linearPhaseShed.load() && !linearPhaseRunning)
     {
-        midiBuffer.clear();
-        pluginInstance->processBlock(pluginBuffer, midiBuffer);
+        linearPhaseEQ.reset();
+        linearPhaseRunning = true;
+        linearPhaseWarmup = 2 * linearPhaseEQ.getLatencySamples();
     }
     
+    // Whatever the denoiser still holds from before it was bypassed is stale
+    // (and its latency would jump in with it), so it restarts empty.
+    const bool denoise = noiseSuppressionEnabled.load();
+    if (denoise && !noiseSuppressionRunning)
+        noiseSuppressor.resetOverlap();
+    noiseSuppressionRunning = denoise;
+    
+    // Device channels taken by mixer sources don't feed the mic chain.
+    const int micInputs = mixer.getNumMicInputs(juce::jmin(numInputChannels, pluginBuffer.getNumChannels()));
+    const auto variant = chainVariants[(size_t)chainChannelVariant][getActiveStages(numSamples, targetGain)];
+    (this->*variant)(inputChannelData, micInputs, numSamples, targetGain);
+    appliedGain = targetGain;
+    
+    updateAutoGain(loudnessMeter.process(pluginBuffer, numSamples));
+    if (networkSenderLive.load(std::memory_order_acquire))
+        networkSender.push(pluginBuffer, numSamples);
+    mixer.process(pluginBuffer, numSamples, inputChannelData, numInputChannels);
+    
     float outLevel = 0.0f;
     for (int ch = 0; ch < pluginBuffer.getNumChannels(); ++ch)
-        outLevel = juce::jmax(outLevel, pluginBuffer.getMagnitude(ch, 0, numSamples));
+        outLevel = juce::jmax(outLevel, kernels.peakMagnitude(pluginBuffer.getReadPointer(ch), numSamples));
     outputLevel.store(outLevel);
     
+    applyDeviceFade(numSamples);
+    
     for (int ch = 0; ch < juce::jmin(numOutputChannels, pluginBuffer.getNumChannels()); ++ch)
     {
         if (outputChannelData[ch] != nullptr)
@@ -148,82 +499,747 @@ void AudioEngine::audioDeviceIOCallbackWithContext(
     }
 }
 
+const std::array<std::array<AudioEngine::ChainVariant, AudioEngine::numStageCombinations>, 3> AudioEngine::chainVariants {
+    makeChainVariants<2>(std::make_index_sequence<numStageCombinations>()),
+    makeChainVariants<8>(std::make_index_sequence<numStageCombinations>()),
+    makeChainVariants<0>(std::make_index_sequence<numStageCombinations>())
+};
+
+unsigned AudioEngine::getActiveStages(int numSamples, float targetGain)
+{
+    unsigned stages = 0;
+    
+    if (noiseSuppressionRunning)
+        stages |= stageDenoise;
+    if (appliedGain != 1.0f || targetGain != 1.0f)
+        stages |= stageGain;
+    if (pluginInstance != nullptr)
+        stages |= stagePlugin;
+    
+    const bool eqFlat = liveTone.bassDb == 0.0f && liveTone.midDb == 0.0f && liveTone.trebleDb == 0.0f;
+    if (!eqFlat)
+        eqTailRemaining = juce::roundToInt(eqTailSeconds * currentSampleRate);
+    else if (eqTailRemaining > 0 && (eqTailRemaining -= numSamples) <= 0)
+        toneFilters.reset();
+    
+    if (eqTailRemaining > 0)
+        stages |= stageEQ;
+    
+    return stages;
+}
+
+template <int NumChannels, unsigned Stages>
+void AudioEngine::runChain(const float* const* inputs, int numInputs, int numSamples, float targetGain)
+{
+    constexpr bool denoise = (Stages & stageDenoise) != 0;
+    constexpr bool gain = (Stages & stageGain) != 0;
+    constexpr bool eq = (Stages & stageEQ) != 0;
+    constexpr bool plugin = (Stages & stagePlugin) != 0;
+    
+    const int numChannels = NumChannels > 0 ? NumChannels : pluginBuffer.getNumChannels();
+    
+    float inLevel = 0.0f;
+    for (int ch = 0; ch < numInputs; ++ch)
+        inLevel = juce::jmax(inLevel, kernels.peakMagnitude(inputs[ch], numSamples));
+    inputLevel.store(inLevel);
+    
+    // A mono input feeds every channel.
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        const float* source = inputs[ch < numInputs ? ch : 0];
+        
+        if constexpr (gain && !denoise)
+            kernels.copyWithGainRamp(pluginBuffer.getWritePointer(ch), source, numSamples, appliedGain, targetGain);
+        else
+            juce::FloatVectorOperations::copy(pluginBuffer.getWritePointer(ch), source, numSamples);
+    }
+    
+    if constexpr (denoise)
+    {
+        noiseSuppressor.process(pluginBuffer, numSamples);
+        
+        if constexpr (gain)
+            for (int ch = 0; ch < numChannels; ++ch)
+                kernels.applyGainRamp(pluginBuffer.getWritePointer(ch), numSamples, appliedGain, targetGain);
+    }
+    
+    if (linearPhaseRunning)
+    {
+        for (int ch = 0; ch < linearPhaseBuffer.getNumChannels(); ++ch)
+            linearPhaseBuffer.copyFrom(ch, 0, pluginBuffer, ch, 0, numSamples);
+    }
+    
+    if constexpr (eq)
+        toneFilters.process(pluginBuffer.getArrayOfWritePointers(), numSamples);
+    
+    processLinearPhaseEQ(numSamples);
+    
+    if (impulseResponseLoaded.load())
+    {
+        // Whatever tail the previous IR left behind must not play out.
+        if (impulseResponseResetPending.exchange(false))
+            irConvolution.reset();
+        
+        juce::dsp::AudioBlock<float> block(pluginBuffer);
+        auto subBlock = block.getSubBlock(0, (size_t)numSamples);
+        irConvolution.process(juce::dsp::ProcessContextReplacing<float>(subBlock));
+    }
+    
+    if constexpr (plugin)
+        processPlugin(numSamples);
+    
+    processClipper(numSamples);
+}
+
 void AudioEngine::setBoostGain(float gainDb)
 {
     boostGainDb = gainDb;
-    currentGain = juce::Decibels::decibelsToGain(gainDb);
+    postToneChange(0.0);
+}
+
+void AudioEngine::setAutoGainEnabled(bool enabled)
+{
+    autoGainEnabled.store(enabled);
+}
+
+void AudioEngine::setAutoGainTarget(float lufs)
+{
+    autoGainTargetLufs.store(lufs);
+}
+
+void AudioEngine::setAutoGainRange(float minDb, float maxDb)
+{
+    autoGainMinDb.store(juce::jmin(minDb, maxDb));
+    autoGainMaxDb.store(juce::jmax(minDb, maxDb));
+}
+
+void AudioEngine::updateAutoGain(int stepsCompleted)
+{
+    if (!autoGainWasEnabled)
+    {
+        autoGainDbPublished.store(liveTone.boostDb);
+        return;
+    }
+    
+    // Only adapt while the input (referred back through the current boost)
+    // is above the speech gate, so pauses and room tone don't pump the gain.
+    constexpr float speechGateLufs = -50.0f;
+    constexpr float maxStepDb = 0.2f;   // 2 dB/s at one step per 100 ms
+    
+    for (int i = 0; i < stepsCompleted; ++i)
+    {
+        const float momentary = loudnessMeter.getMomentaryLoudness();
+        if (momentary - autoGainDb < speechGateLufs)
+            continue;
+        
+        const float error = autoGainTargetLufs.load() - loudnessMeter.getShortTermLoudness();
+        autoGainDb += juce::jlimit(-maxStepDb, maxStepDb, error * 0.1f);
+        autoGainDb = juce::jlimit(autoGainMinDb.load(), autoGainMaxDb.load(), autoGainDb);
+    }
+    
+    autoGainDbPublished.store(autoGainDb);
 }
 
 void AudioEngine::setInputDevice(const juce::String& deviceName)
 {
-    auto setup = deviceManager.getAudioDeviceSetup();
-    setup.inputDeviceName = deviceName;
-    deviceManager.setAudioDeviceSetup(setup, true);
+    configureDevice().withInputDevice(deviceName).apply();
 }
 
 void AudioEngine::setOutputDevice(const juce::String& deviceName)
 {
-    auto setup = deviceManager.getAudioDeviceSetup();
-    setup.outputDeviceName = deviceName;
+    configureDevice().withOutputDevice(deviceName).apply();
+}
+
+bool AudioEngine::DeviceConfig::apply()
+{
+    if (!engine.initialized.load())
+        return false;
+    
+    auto setup = engine.deviceManager.getAudioDeviceSetup();
+    bool changed = false;
+    
+    auto assign = [&changed](auto& current, const auto& requested) {
+        if (requested.has_value() && current != *requested)
+        {
+            current = *requested;
+            changed = true;
+        }
+    };
+    
+    assign(setup.inputDeviceName, inputDevice);
+    assign(setup.outputDeviceName, outputDevice);
+    assign(setup.sampleRate, sampleRate);
+    assign(setup.bufferSize, bufferSize);
+    
+    if (!changed)
+        return false;
+    
+    engine.applyDeviceSetup(setup);
+    return true;
+}
+
+void AudioEngine::applyDeviceSetup(const juce::AudioDeviceManager::AudioDeviceSetup& setup)
+{
+    const juce::ScopedLock sl(switchLock);
+    fadeOutForDeviceChange();
     deviceManager.setAudioDeviceSetup(setup, true);
+    
+    // If the device didn't restart (or failed to), don't stay muted.
+    int expected = silent;
+    fadeState.compare_exchange_strong(expected, fadingIn);
 }
 
-juce::StringArray AudioEngine::getAvailableInputDevices()
+juce::String AudioEngine::getCurrentInputDeviceName() const
 {
-    auto* deviceType = deviceManager.getCurrentDeviceTypeObject();
-    if (deviceType != nullptr)
-    {
-        deviceType->scanForDevices();
-        return deviceType->getDeviceNames(true);
-    }
-    return juce::StringArray();
+    return deviceManager.getAudioDeviceSetup().inputDeviceName;
 }
 
-juce::StringArray AudioEngine::getAvailableOutputDevices()
+juce::String AudioEngine::getCurrentOutputDeviceName() const
 {
-    auto* deviceType = deviceManager.getCurrentDeviceTypeObject();
-    if (deviceType != nullptr)
-    {
-        deviceType->scanForDevices();
-        return deviceType->getDeviceNames(false);
-    }
-    return juce::StringArray();
+    return deviceManager.getAudioDeviceSetup().outputDeviceName;
+}
+
+double AudioEngine::getDeviceSampleRate() const
+{
+    return deviceManager.getAudioDeviceSetup().sampleRate;
+}
+
+int AudioEngine::getDeviceBufferSize() const
+{
+    return deviceManager.getAudioDeviceSetup().bufferSize;
+}
+
+juce::StringArray AudioEngine::getAvailableInputDevices() const
+{
+    return deviceRegistry.getInputDevices();
+}
+
+juce::StringArray AudioEngine::getAvailableOutputDevices() const
+{
+    return deviceRegistry.getOutputDevices();
 }
 
 void AudioEngine::setBassGain(float gainDb)
 {
     bassGainDb = gainDb;
-    updateEQFilters();
+    linearPhaseEQ.setBands(bassGainDb, midGainDb, trebleGainDb);
+    postToneChange(toneSmoothingMs);
 }
 
 void AudioEngine::setMidGain(float gainDb)
 {
     midGainDb = gainDb;
-    updateEQFilters();
+    linearPhaseEQ.setBands(bassGainDb, midGainDb, trebleGainDb);
+    postToneChange(toneSmoothingMs);
 }
 
 void AudioEngine::setTrebleGain(float gainDb)
 {
     trebleGainDb = gainDb;
-    updateEQFilters();
+    linearPhaseEQ.setBands(bassGainDb, midGainDb, trebleGainDb);
+    postToneChange(toneSmoothingMs);
+}
+
+void AudioEngine::setLinearPhaseEQ(bool enabled)
+{
+    linearPhaseRequested.store(enabled);
+}
+
+int AudioEngine::getLatencySamples() const
+{
+    int latency = linearPhaseRequested.load() && !linearPhaseShed.load() ? linearPhaseEQ.getLatencySamples() : 0;
+    
+    if (noiseSuppressionEnabled.load())
+        latency += noiseSuppressor.getLatencySamples();
+    if (schedulerBuffered)
+        latency += schedulerBlockSize;
+    
+    if (clipperEnabled.load())
+        latency += clipperOversampler.getLatencySamples();
+    if (pluginInstance != nullptr)
+        latency += pluginOversampler.getLatencySamples();
+    
+    return latency;
+}
+
+void AudioEngine::processLinearPhaseEQ(int numSamples)
+{
+    if (!linearPhaseRunning)
+        return;
+    
+    juce::dsp::AudioBlock<float> block(linearPhaseBuffer);
+    auto subBlock = block.getSubBlock(0, (size_t)numSamples);
+    linearPhaseEQ.process(juce::dsp::ProcessContextReplacing<float>(subBlock));
+    
+    if (linearPhaseWarmup > 0)
+    {
+        linearPhaseWarmup -= numSamples;
+        return;
+    }
+    
+    // The FIR output lags the IIR one by its latency, so mixing them would
+    // flam. Ramp the playing path out over 10 ms, swap at silence, and ramp
+    // the other one in.
+    const bool target = linearPhaseRequested.load() && !linearPhaseShed.load();
+    const float step = (float)numSamples / (float)(0.01 * currentSampleRate);
+    const float startGain = linearPhaseSwapGain;
+    const float endGain = target != linearPhaseOutput ? juce::jmax(0.0f, startGain - step)
+                                                      : juce::jmin(1.0f, startGain + step);
+    
+    for (int ch = 0; ch < pluginBuffer.getNumChannels(); ++ch)
+    {
+        float* dest = pluginBuffer.getWritePointer(ch);
+        if (linearPhaseOutput)
+            kernels.copyWithGainRamp(dest, linearPhaseBuffer.getReadPointer(ch), numSamples, startGain, endGain);
+        else if (startGain != 1.0f || endGain != 1.0f)
+            kernels.applyGainRamp(dest, numSamples, startGain, endGain);
+    }
+    
+    linearPhaseSwapGain = endGain;
+    if (endGain == 0.0f)
+        linearPhaseOutput = target;
+    if (!target && !linearPhaseOutput && endGain == 1.0f)
+        linearPhaseRunning = false;
+}
+
+void AudioEngine::setNoiseSuppressionEnabled(bool enabled)
+{
+    // The denoiser adds a frame of latency, so switch under a fade.
+    if (enabled != noiseSuppressionEnabled.load())
+        switchWithFade([this, enabled] { noiseSuppressionEnabled.store(enabled); });
+}
+
+void AudioEngine::setNoiseSuppressionMode(NoiseSuppressor::Mode mode)
+{
+    noiseSuppressor.setMode(mode);
+}
+
+void AudioEngine::setNoiseReduction(float reductionDb)
+{
+    noiseSuppressor.setReduction(reductionDb);
+}
+
+void AudioEngine::setNoiseLearning(bool shouldLearn)
+{
+    noiseSuppressor.setLearning(shouldLearn);
+}
+
+void AudioEngine::setClipperEnabled(bool enabled)
+{
+    clipperEnabled.store(enabled);
+}
+
+void AudioEngine::setStageOversampling(OversampledStage stage, StageOversampler::Factor factor)
+{
+    oversamplingRequested[(size_t)stage].store((int)factor);
+    applyStageOversampling(stage);
+}
+
+void AudioEngine::applyStageOversampling(OversampledStage stage)
+{
+    const auto factor = getEffectiveOversampling(stage);
+    
+    if (stage == OversampledStage::clipper)
+    {
+        clipperOversampler.setFactor(factor);
+        return;
+    }
+    
+    // Message thread from here on, like every other plugin swap.
+    if (pluginOversampler.getFactor() == factor)
+        return;
+    
+    if (pluginInstance == nullptr)
+    {
+        pluginOversampler.setFactor(factor);
+        return;
+    }
+    
+    // The plugin runs at the oversampled rate. Re-preparing the running
+    // instance would hold the callback off for the whole prepareToPlay(), so
+    // a second one is prepared at the new rate with the current state and
+    // swapped in together with the factor.
+    juce::MemoryBlock state;
+    pluginInstance->getStateInformation(state);
+    
+    juce::WeakReference<AudioEngine> weakThis(this);
+    const int generation = pluginGeneration;
+    const int ratio = 1 << (int)factor;
+    
+    pluginFormatManager.createPluginInstanceAsync(pluginInstance->getPluginDescription(),
+        currentSampleRate * ratio, currentBufferSize * ratio,
+        [weakThis, generation, state, factor](std::unique_ptr<juce::AudioPluginInstance> instance, const juce::String& error)
+        {
+            if (weakThis == nullptr)
+                return;
+            
+            if (instance == nullptr)
+            {
+                juce::Logger::writeToLog("Couldn't re-create the plugin for oversampling: " + error);
+                return;
+            }
+            
+            // Superseded by another plugin or another factor change meanwhile.
+            if (weakThis->pluginGeneration == generation
+                && weakThis->getEffectiveOversampling(OversampledStage::plugin) == factor)
+                weakThis->installPlugin(std::move(instance), &state, factor);
+        });
+}
+
+StageOversampler::Factor AudioEngine::getEffectiveOversampling(OversampledStage stage) const
+{
+    const auto index = (size_t)stage;
+    return (StageOversampler::Factor)juce::jmax((int)StageOversampler::Factor::off,
+                                                oversamplingRequested[index].load() - oversamplingShed[index].load());
+}
+
+void AudioEngine::setOversamplingFilter(StageOversampler::Filter filter)
+{
+    const juce::ScopedLock sl(deviceManager.getAudioCallbackLock());
+    clipperOversampler.setFilter(filter);
+    pluginOversampler.setFilter(filter);
+}
+
+StageOversampler::Factor AudioEngine::getStageOversampling(OversampledStage stage) const
+{
+    return (StageOversampler::Factor)oversamplingRequested[(size_t)stage].load();
+}
+
+void AudioEngine::setOverloadGovernorEnabled(bool enabled)
+{
+    overloadGovernorEnabled = enabled;
+    if (initialized.load())
+        overloadGovernor.setEnabled(enabled);
+}
+
+void AudioEngine::setNetworkOutput(const RtpAudioSender::Options& options)
+{
+    // The sender reallocates its FIFO, so no push() may be in flight. Once
+    // the lock has been taken with the flag down, none is; the restart itself
+    // stays outside the lock.
+    {
+        const juce::ScopedLock sl(deviceManager.getAudioCallbackLock());
+        networkSenderLive.store(false);
+    }
+    
+    networkSender.setOptions(options);
+    networkSenderLive.store(true, std::memory_order_release);
+}
+
+bool AudioEngine::setNetworkInput(int port)
+{
+    // Only the source swap happens under the lock; once it's released no
+    // callback is pulling from the receiver, and the socket and thread work
+    // below can take as long as it likes.
+    {
+        const juce::ScopedLock sl(deviceManager.getAudioCallbackLock());
+        mixer.clearSource(DuckingMixer::networkSlot);
+    }
+    
+    networkReceiver.stop();
+    if (port <= 0)
+        return true;
+    
+    // prepareProcessing() keeps the rate in step with the device.
+    if (!networkReceiver.start(port, currentSampleRate))
+        return false;
+    
+    const juce::ScopedLock sl(deviceManager.getAudioCallbackLock());
+    mixer.setNetworkSource(DuckingMixer::networkSlot, &networkReceiver);
+    mixer.setSourceDucked(DuckingMixer::networkSlot, false);
+    return true;
+}
+
+void AudioEngine::addOverloadSteps()
+{
+    // Cheapest loss of quality first. Nothing here fades through silence or
+    // waits on the audio thread: the linear-phase EQ falls back to the IIRs
+    // through its own swap fade, the denoiser crossfades to a plain delay,
+    // and oversampling steps down a factor per shed.
+    overloadGovernor.addStep({ "linear-phase EQ -> IIR EQ",
+        [this] { return linearPhaseRequested.load() && !linearPhaseShed.load(); },
+        [this] { linearPhaseShed.store(true); },
+        [this] { linearPhaseShed.store(false); } });
+    
+    auto oversamplingStep = [this](OversampledStage stage, const char* name)
+    {
+        const auto index = (size_t)stage;
+        
+        // The clipper's factor is an index change the audio thread picks up;
+        // a plugin swap belongs to the message thread.
+        auto apply = [this, stage]
+        {
+            if (stage == OversampledStage::clipper)
+            {
+                applyStageOversampling(stage);
+                return;
+            }
+            
+            juce::WeakReference<AudioEngine> weakThis(this);
+            juce::MessageManager::callAsync([weakThis]
+            {
+                if (weakThis != nullptr)
+                    weakThis->applyStageOversampling(OversampledStage::plugin);
+            });
+        };
+        
+        return OverloadGovernor::Step { name,
+            [this, stage]
+            {
+                const bool active = stage == OversampledStage::clipper ? clipperEnabled.load() : hasPluginLoaded();
+                return active && getEffectiveOversampling(stage) != StageOversampler::Factor::off;
+            },
+            [this, index, apply] { ++oversamplingShed[index]; apply(); },
+            [this, index, apply] { if (oversamplingShed[index].load() > 0) --oversamplingShed[index]; apply(); } };
+    };
+    
+    overloadGovernor.addStep(oversamplingStep(OversampledStage::clipper, "clipper oversampling -> one factor lower"));
+    overloadGovernor.addStep(oversamplingStep(OversampledStage::plugin, "plugin oversampling -> one factor lower"));
+    
+    overloadGovernor.addStep({ "noise suppression -> bypassed",
+        [this] { return noiseSuppressionEnabled.load() && !noiseSuppressor.isBypassed(); },
+        [this] { noiseSuppressor.setBypassed(true); },
+        [this] { noiseSuppressor.setBypassed(false); } });
+}
+
+void AudioEngine::processClipper(int numSamples)
+{
+    clipperReductionDb = 0.0f;
+    if (!clipperEnabled.load())
+        return;
+    
+    // Peak before and after, for the published gain reduction.
+    const bool measure = metricsPublisher.isOpen();
+    auto peak = [this, numSamples]
+    {
+        float level = 0.0f;
+        for (int ch = 0; ch < pluginBuffer.getNumChannels(); ++ch)
+            level = juce::jmax(level, kernels.peakMagnitude(pluginBuffer.getReadPointer(ch), numSamples));
+        return level;
+    };
+    const float peakIn = measure ? peak() : 0.0f;
+    
+    juce::dsp::AudioBlock<float> block(pluginBuffer);
+    auto subBlock = block.getSubBlock(0, (size_t)numSamples);
+    auto upBlock = clipperOversampler.processUp(subBlock);
+    
+    // Cubic soft clip: unity slope at zero, flat at +-1.5 -> +-1.0.
+    for (size_t ch = 0; ch < upBlock.getNumChannels(); ++ch)
+    {
+        auto* data = upBlock.getChannelPointer(ch);
+        for (size_t i = 0; i < upBlock.getNumSamples(); ++i)
+        {
+            const float x = juce::jlimit(-1.5f, 1.5f, data[i]);
+            data[i] = x - (4.0f / 27.0f) * x * x * x;
+        }
+    }
+    
+    clipperOversampler.processDown(subBlock);
+    
+    if (measure && peakIn > 0.0f)
+        clipperReductionDb = juce::jmin(0.0f, juce::Decibels::gainToDecibels(peak() / peakIn));
+}
+
+void AudioEngine::publishMetrics(int numSamples, juce::int64 startTicks) noexcept
+{
+    if (!metricsPublisher.isOpen())
+        return;
+    
+    SharedMetrics::Values values;
+    values.numChannels = numProcessChannels;
+    values.inputPeak = inputLevel.load(std::memory_order_relaxed);
+    values.outputPeak = outputLevel.load(std::memory_order_relaxed);
+    values.shortTermLufs = loudnessMeter.getShortTermLoudness();
+    values.integratedLufs = loudnessMeter.getIntegratedLoudness();
+    values.boostDb = autoGainEnabled.load() ? autoGainDbPublished.load() : liveTone.boostDb;
+    values.duckingDb = mixer.getDuckingDb();
+    values.clipperReductionDb = clipperReductionDb;
+    values.shedStages = (juce::uint32)overloadGovernor.getNumShedSteps();
+    
+    // Every backend just returns a counter here.
+    if (runningDevice != nullptr)
+        values.deviceXruns = (juce::uint32)juce::jmax(0, runningDevice->getXRunCount());
+    
+    const auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    metricsPublisher.publish(values, numSamples, currentSampleRate, elapsed);
+}
+
+bool AudioEngine::setMetricsFile(const juce::File& file)
+{
+    const juce::ScopedLock sl(deviceManager.getAudioCallbackLock());
+    if (file == juce::File())
+    {
+        metricsPublisher.close();
+        return true;
+    }
+    return metricsPublisher.open(file);
+}
+
+void AudioEngine::processPlugin(int numSamples)
+{
+    // Only reached from chain variants built with stagePlugin.
+    midiBuffer.clear();
+    
+    // pluginBuffer is sized for the largest block seen; the plugin only ever
+    // gets this chunk's samples, never stale ones past them.
+    float* channels[maxProcessChannels] = {};
+    
+    if (pluginOversampler.getFactor() == StageOversampler::Factor::off)
+    {
+        const int numChannels = juce::jmin(maxProcessChannels, pluginBuffer.getNumChannels());
+        for (int ch = 0; ch < numChannels; ++ch)
+            channels[ch] = pluginBuffer.getWritePointer(ch);
+        
+        pluginBlockView.setDataToReferTo(channels, numChannels, numSamples);
+        pluginInstance->processBlock(pluginBlockView, midiBuffer);
+        return;
+    }
+    
+    juce::dsp::AudioBlock<float> block(pluginBuffer);
+    auto subBlock = block.getSubBlock(0, (size_t)numSamples);
+    auto upBlock = pluginOversampler.processUp(subBlock);
+    
+    const int numChannels = juce::jmin(maxProcessChannels, (int)upBlock.getNumChannels());
+    for (int ch = 0; ch < numChannels; ++ch)
+        channels[ch] = upBlock.getChannelPointer((size_t)ch);
+    
+    pluginBlockView.setDataToReferTo(channels, numChannels, (int)upBlock.getNumSamples());
+    pluginInstance->processBlock(pluginBlockView, midiBuffer);
+    
+    pluginOversampler.processDown(subBlock);
+}
+
+void AudioEngine::preparePlugin()
+{
+    if (pluginInstance == nullptr)
+        return;
+    
+    const int ratio = pluginOversampler.getRatio();
+    pluginInstance->releaseResources();
+    pluginInstance->setRateAndBufferSizeDetails(currentSampleRate * ratio, currentBufferSize * ratio);
+    pluginInstance->prepareToPlay(currentSampleRate * ratio, currentBufferSize * ratio);
+}
+
+void AudioEngine::postToneChange(double rampMs)
+{
+    const juce::SpinLock::ScopedLockType sl(toneLock);
+    pendingTone = { boostGainDb, bassGainDb, midGainDb, trebleGainDb };
+    pendingToneRampMs = rampMs;
+    tonePending.store(true);
+}
+
+void AudioEngine::updateTone(int numSamples)
+{
+    if (tonePending.load())
+    {
+        // Never wait for the message thread; pick it up next block instead.
+        const juce::SpinLock::ScopedTryLockType tl(toneLock);
+        if (tl.isLocked())
+        {
+            toneFrom = liveTone;
+            toneTo = pendingTone;
+            toneRampPosition = 0;
+            // In samples at the rate running now: a change posted before
+            // the device opened would otherwise ramp at the default rate.
+            toneRampLength = juce::roundToInt(pendingToneRampMs * 0.001 * currentSampleRate);
+            tonePending.store(false);
+            
+            if (toneRampLength == 0)
+            {
+                const bool eqChanged = toneTo.bassDb != liveTone.bassDb
+                                    || toneTo.midDb != liveTone.midDb
+                                    || toneTo.trebleDb != liveTone.trebleDb;
+                liveTone = toneTo;
+                if (eqChanged)
+                    updateEQFilters(liveTone);
+            }
+        }
+    }
+    
+    if (toneRampPosition >= toneRampLength)
+        return;
+    
+    // Stepped once per block; the boost is further smoothed by the gain ramp.
+    toneRampPosition = juce::jmin(toneRampLength, toneRampPosition + numSamples);
+    const float t = (float)toneRampPosition / (float)toneRampLength;
+    liveTone.boostDb = juce::jmap(t, toneFrom.boostDb, toneTo.boostDb);
+    liveTone.bassDb = juce::jmap(t, toneFrom.bassDb, toneTo.bassDb);
+    liveTone.midDb = juce::jmap(t, toneFrom.midDb, toneTo.midDb);
+    liveTone.trebleDb = juce::jmap(t, toneFrom.trebleDb, toneTo.trebleDb);
+    updateEQFilters(liveTone);
 }
 
-void AudioEngine::updateEQFilters()
+void AudioEngine::updateEQFilters(const ToneState& tone)
 {
-    auto bassCoeffs = juce::dsp::IIR::Coefficients<float>::makeLowShelf(
-        currentSampleRate, 200.0f, 0.707f, juce::Decibels::decibelsToGain(bassGainDb));
-    *bassFilterL.coefficients = *bassCoeffs;
-    *bassFilterR.coefficients = *bassCoeffs;
+    using Design = juce::dsp::IIR::ArrayCoefficients<float>;
+    const auto rate = currentSampleRate;
     
-    auto midCoeffs = juce::dsp::IIR::Coefficients<float>::makePeakFilter(
-        currentSampleRate, 1000.0f, 1.0f, juce::Decibels::decibelsToGain(midGainDb));
-    *midFilterL.coefficients = *midCoeffs;
-    *midFilterR.coefficients = *midCoeffs;
+    toneFilters.setCoefficients(0, Design::makeLowShelf(rate, 200.0f, 0.707f, juce::Decibels::decibelsToGain(tone.bassDb)));
+    toneFilters.setCoefficients(1, Design::makePeakFilter(rate, 1000.0f, 1.0f, juce::Decibels::decibelsToGain(tone.midDb)));
+    toneFilters.setCoefficients(2, Design::makeHighShelf(rate, 4000.0f, 0.707f, juce::Decibels::decibelsToGain(tone.trebleDb)));
+}
+
+AudioEngine::Snapshot AudioEngine::getSnapshot() const
+{
+    Snapshot snapshot;
+    snapshot.boostDb = boostGainDb;
+    snapshot.bassDb = bassGainDb;
+    snapshot.midDb = midGainDb;
+    snapshot.trebleDb = trebleGainDb;
+    snapshot.autoGain = autoGainEnabled.load();
+    snapshot.autoGainTarget = autoGainTargetLufs.load();
+    snapshot.linearPhase = linearPhaseRequested.load();
+    snapshot.noiseSuppression = noiseSuppressionEnabled.load();
+    snapshot.noiseReduction = noiseSuppressor.getReduction();
+    snapshot.clipper = clipperEnabled.load();
+    
+    if (pluginInstance != nullptr)
+    {
+        snapshot.pluginIdentifier = pluginInstance->getPluginDescription().createIdentifierString();
+        pluginInstance->getStateInformation(snapshot.pluginState);
+    }
     
-    auto trebleCoeffs = juce::dsp::IIR::Coefficients<float>::makeHighShelf(
-        currentSampleRate, 4000.0f, 0.707f, juce::Decibels::decibelsToGain(trebleGainDb));
-    *trebleFilterL.coefficients = *trebleCoeffs;
-    *trebleFilterR.coefficients = *trebleCoeffs;
+    return snapshot;
+}
+
+void AudioEngine::recallSnapshot(const Snapshot& snapshot, double crossfadeMs)
+{
+    boostGainDb = snapshot.boostDb;
+    bassGainDb = snapshot.bassDb;
+    midGainDb = snapshot.midDb;
+    trebleGainDb = snapshot.trebleDb;
+    linearPhaseEQ.setBands(bassGainDb, midGainDb, trebleGainDb);
+    postToneChange(juce::jmax(0.0, crossfadeMs));
+    
+    // Followed gradually, or swapped under their own fade.
+    setAutoGainTarget(snapshot.autoGainTarget);
+    setNoiseReduction(snapshot.noiseReduction);
+    setLinearPhaseEQ(snapshot.linearPhase);
+    
+    const bool restorePluginState = pluginInstance != nullptr && snapshot.pluginState.getSize() > 0
+        && snapshot.pluginIdentifier == pluginInstance->getPluginDescription().createIdentifierString();
+    const bool switchesChange = snapshot.autoGain != autoGainEnabled.load()
+                             || snapshot.noiseSuppression != noiseSuppressionEnabled.load()
+                             || snapshot.clipper != clipperEnabled.load();
+    if (!switchesChange && !restorePluginState)
+        return;
+    
+    // The rest can't be morphed, so it changes at silence: the output fades
+    // out, the switches and the plugin state are applied, and it fades back
+    // in while boost and EQ carry on morphing.
+    switchWithFade([this, &snapshot, restorePluginState]
+    {
+        autoGainEnabled.store(snapshot.autoGain);
+        noiseSuppressionEnabled.store(snapshot.noiseSuppression);
+        clipperEnabled.store(snapshot.clipper);
+        
+        // Not while processBlock() runs; the output is silent anyway.
+        if (restorePluginState)
+        {
+            const juce::ScopedLock sl(deviceManager.getAudioCallbackLock());
+            pluginInstance->setStateInformation(snapshot.pluginState.getData(), (int)snapshot.pluginState.getSize());
+        }
+    });
 }
 
 void AudioEngine::loadPlugin(const juce::File& pluginFile)
@@ -240,22 +1256,121 @@ void AudioEngine::loadPlugin(const juce::File& pluginFile)
     if (descriptions.size() > 0)
     {
         juce::String errorMessage;
-        pluginInstance = pluginFormatManager.createPluginInstance(
+        auto instance = pluginFormatManager.createPluginInstance(
             *descriptions[0], currentSampleRate, 
             (int)pluginBuffer.getNumSamples(), errorMessage);
         
-        if (pluginInstance != nullptr)
-            pluginInstance->prepareToPlay(currentSampleRate, pluginBuffer.getNumSamples());
+        if (instance != nullptr)
+            installPlugin(std::move(instance), nullptr, pluginOversampler.getFactor());
     }
 }
 
-void AudioEngine::removePlugin()
+void AudioEngine::restorePlugin(const juce::PluginDescription& description,
+                                const juce::MemoryBlock& state,
+                                std::function<void(bool)> onRestored)
+{
+    juce::WeakReference<AudioEngine> weakThis(this);
+    const int generation = pluginGeneration;
+    
+    pluginFormatManager.createPluginInstanceAsync(description, currentSampleRate, currentBufferSize,
+        [weakThis, generation, state, onRestored](std::unique_ptr<juce::AudioPluginInstance> instance, const juce::String&)
+        {
+            if (weakThis == nullptr)
+                return;
+            
+            // Don't replace a plugin the user loaded or removed meanwhile.
+            const bool restored = instance != nullptr && weakThis->pluginGeneration == generation;
+            if (restored)
+                weakThis->installPlugin(std::move(instance), &state, weakThis->pluginOversampler.getFactor());
+            
+            if (onRestored)
+                onRestored(restored);
+        });
+}
+
+void AudioEngine::installPlugin(std::unique_ptr<juce::AudioPluginInstance> instance, const juce::MemoryBlock* state,
+                                StageOversampler::Factor factor)
+{
+    // Prepared (and given its state) before it is swapped in, so the audio
+    // thread only waits for the pointer exchange.
+    const int ratio = 1 << (int)factor;
+    const double rate = currentSampleRate * ratio;
+    const int blockSize = currentBufferSize * ratio;
+    instance->setRateAndBufferSizeDetails(rate, blockSize);
+    instance->prepareToPlay(rate, blockSize);
+    
+    if (state != nullptr && state->getSize() > 0)
+        instance->setStateInformation(state->getData(), (int)state->getSize());
+    
+    ++pluginGeneration;
+    
+    std::unique_ptr<juce::AudioPluginInstance> previous;
+    {
+        const juce::ScopedLock sl(deviceManager.getAudioCallbackLock());
+        previous = std::exchange(pluginInstance, std::move(instance));
+        pluginOversampler.setFactor(factor);
+        
+        // The device may have restarted at another rate in the meantime.
+        if (currentSampleRate * ratio != rate || currentBufferSize * ratio != blockSize)
+            preparePlugin();
+    }
+    
+    if (previous != nullptr)
+        previous->releaseResources();
+    
+    // Pick up the plugin's pages if only current ones could be locked.
+    realtimeTuning.lockMemory();
+}
+
+std::unique_ptr<juce::XmlElement> AudioEngine::getPluginDescriptionXml() const
 {
+    if (pluginInstance == nullptr)
+        return {};
+    return pluginInstance->getPluginDescription().createXml();
+}
+
+juce::MemoryBlock AudioEngine::getPluginState() const
+{
+    juce::MemoryBlock state;
     if (pluginInstance != nullptr)
+        pluginInstance->getStateInformation(state);
+    return state;
+}
+
+void AudioEngine::removePlugin()
+{
+    ++pluginGeneration;
+    
+    std::unique_ptr<juce::AudioPluginInstance> previous;
     {
-        pluginInstance->releaseResources();
-        pluginInstance.reset();
+        const juce::ScopedLock sl(deviceManager.getAudioCallbackLock());
+        previous = std::move(pluginInstance);
     }
+    
+    if (previous != nullptr)
+        previous->releaseResources();
+}
+
+void AudioEngine::loadImpulseResponse(const juce::File& irFile)
+{
+    if (!irFile.existsAsFile())
+        return;
+    
+    impulseResponseFile = irFile;
+    impulseResponseResetPending.store(true);
+    irConvolution.loadImpulseResponse(irFile,
+                                      juce::dsp::Convolution::Stereo::yes,
+                                      juce::dsp::Convolution::Trim::yes,
+                                      0,
+                                      juce::dsp::Convolution::Normalise::yes);
+    impulseResponseLoaded.store(true);
+}
+
+void AudioEngine::clearImpulseResponse()
+{
+    impulseResponseLoaded.store(false);
+    impulseResponseResetPending.store(true);
+    impulseResponseFile = juce::File();
 }
 
 juce::String AudioEngine::getPluginName() const
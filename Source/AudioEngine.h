@@ -2,16 +2,104 @@
 #include <juce_audio_devices/juce_audio_devices.h>
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_dsp/juce_dsp.h>
+#include <array>
+#include <optional>
+#include <thread>
+#include <utility>
+#include "BiquadCascade.h"
+#include "DeviceRegistry.h"
+#include "DspKernels.h"
+#include "DuckingMixer.h"
+#include "LinearPhaseEQ.h"
+#include "LoudnessMeter.h"
+#include "MetricsPublisher.h"
+#include "MultichannelConvolution.h"
+#include "NoiseSuppressor.h"
+#include "OverloadGovernor.h"
+#include "RealtimeTuning.h"
+#include "RtpAudioReceiver.h"
+#include "RtpAudioSender.h"
+#include "ScopedComInitialiser.h"
+#include "StageOversampler.h"
+#include "VirtualAudioDevice.h"
 
 class AudioEngine : public juce::AudioIODeviceCallback
 {
 public:
+    // Nonlinear stages that can be run oversampled.
+    enum class OversampledStage { clipper = 0, plugin };
+    
+    // Everything a preset recalls. The plugin blob is captured up front, so
+    // recalling it is a setStateInformation call rather than a reload.
+    struct Snapshot
+    {
+        float boostDb = 0.0f;
+        float bassDb = 0.0f;
+        float midDb = 0.0f;
+        float trebleDb = 0.0f;
+        bool autoGain = false;
+        float autoGainTarget = -18.0f;
+        bool linearPhase = false;
+        bool noiseSuppression = false;
+        float noiseReduction = 18.0f;
+        bool clipper = false;
+        juce::String pluginIdentifier;
+        juce::MemoryBlock pluginState;
+    };
+    
     AudioEngine();
     ~AudioEngine();
     
-    void initialize();
+    // Registers the plugin formats and opens the device once, going straight
+    // to preferredSetup when given (defaults fill in anything missing). If
+    // that fails, the same devices are tried at their default rate and
+    // buffer size, then the default devices; each step is logged.
+    void initialize(const juce::AudioDeviceManager::AudioDeviceSetup* preferredSetup = nullptr);
+    
+    // Same, on a background thread; onReady runs on the message thread. The
+    // plugin formats are registered before it returns, so plugins can load
+    // while the device opens. Device selection calls are ignored, and DSP
+    // switches skip their fade, until then.
+    void initializeAsync(const juce::AudioDeviceManager::AudioDeviceSetup& preferredSetup,
+                         std::function<void()> onReady);
+    bool isInitialized() const { return initialized.load(); }
     void shutdown();
     
+    // Runs the engine on a VirtualAudioIODeviceType instead of hardware.
+    // Must be called before initialize().
+    void useVirtualDevice(const VirtualAudioIODeviceType::Options& options);
+    bool isUsingVirtualDevice() const { return usingVirtualDevice; }
+    
+    // Realtime scheduling, CPU pinning and memory locking (Linux). Must be
+    // called before initialize(); the outcome of each step is reported.
+    void setRealtimeOptions(const RealtimeTuning::Options& options) { realtimeTuning.setOptions(options); }
+    juce::StringArray getRealtimeReport() const { return realtimeTuning.getReport(); }
+    
+    // Sheds optional work under sustained overload instead of dropping out,
+    // and restores it once there is headroom again; on by default except on
+    // a free-running virtual device, where timing means nothing.
+    void setOverloadGovernorEnabled(bool enabled);
+    bool isOverloadGovernorEnabled() const { return overloadGovernorEnabled; }
+    int getNumShedStages() const { return overloadGovernor.getNumShedSteps(); }
+    juce::StringArray getOverloadDecisions() const { return overloadGovernor.getDecisionLog(); }
+    
+    // Streams the processed mic (before the mixer) as RTP; an empty host
+    // stops it. Can be called before initialize().
+    void setNetworkOutput(const RtpAudioSender::Options& options);
+    RtpAudioSender::Stats getNetworkOutputStats() const { return networkSender.getStats(); }
+    
+    // Receives an RTP stream on a UDP port and mixes it in, unducked, at
+    // the device rate; 0 stops it. False if the port can't be bound.
+    bool setNetworkInput(int port);
+    bool isNetworkInputActive() const { return networkReceiver.isReceiving(); }
+    RtpAudioReceiver::Stats getNetworkInputStats() const { return networkReceiver.getStats(); }
+    
+    // Publishes meters, gain changes, callback timing and xruns to a shared
+    // memory file every callback, for external monitoring; an empty file
+    // stops it. False if the file can't be created or mapped.
+    bool setMetricsFile(const juce::File& file);
+    juce::File getMetricsFile() const { return metricsPublisher.getFile(); }
+    
     void audioDeviceIOCallbackWithContext(const float* const* inputChannelData,
                                          int numInputChannels,
                                          float* const* outputChannelData,
@@ -21,51 +109,337 @@ public:
     void audioDeviceAboutToStart(juce::AudioIODevice* device) override;
     void audioDeviceStopped() override;
     
+    // Fixed DSP block size, decoupled from the driver's buffer size (0 =
+    // follow the device). Driver blocks that are a multiple of it are split
+    // in place; anything else is re-blocked through FIFOs at the cost of
+    // one block of latency.
+    void setInternalBlockSize(int blockSize);
+    int getInternalBlockSize() const { return internalBlockSize.load(); }
+    
     void setBoostGain(float gainDb);
+    // Batches device changes into a single setAudioDeviceSetup when
+    // applied; values equal to the current setup are dropped, and a
+    // transaction with nothing left doesn't touch the device at all.
+    class DeviceConfig
+    {
+    public:
+        DeviceConfig& withInputDevice(const juce::String& name) { inputDevice = name; return *this; }
+        DeviceConfig& withOutputDevice(const juce::String& name) { outputDevice = name; return *this; }
+        DeviceConfig& withSampleRate(double rate) { sampleRate = rate; return *this; }
+        DeviceConfig& withBufferSize(int samples) { bufferSize = samples; return *this; }
+        
+        // Returns true if the device was reconfigured.
+        bool apply();
+        
+    private:
+        friend class AudioEngine;
+        explicit DeviceConfig(AudioEngine& e) : engine(e) {}
+        
+        AudioEngine& engine;
+        std::optional<juce::String> inputDevice, outputDevice;
+        std::optional<double> sampleRate;
+        std::optional<int> bufferSize;
+    };
+    
+    DeviceConfig configureDevice() { return DeviceConfig(*this); }
     void setInputDevice(const juce::String& deviceName);
     void setOutputDevice(const juce::String& deviceName);
     
     void setBassGain(float gainDb);
     void setMidGain(float gainDb);
     void setTrebleGain(float gainDb);
+    void setLinearPhaseEQ(bool enabled);
+    
+    void setNoiseSuppressionEnabled(bool enabled);
+    void setNoiseSuppressionMode(NoiseSuppressor::Mode mode);
+    void setNoiseReduction(float reductionDb);
+    void setNoiseLearning(bool shouldLearn);
+    
+    void setClipperEnabled(bool enabled);
+    void setStageOversampling(OversampledStage stage, StageOversampler::Factor factor);
+    void setOversamplingFilter(StageOversampler::Filter filter);
+    
+    void setAutoGainEnabled(bool enabled);
+    void setAutoGainTarget(float lufs);
+    void setAutoGainRange(float minDb, float maxDb);
+    
+    // Boost and EQ morph from their current values over crossfadeMs on the
+    // audio thread, and the linear-phase EQ swaps under its own fade. Auto
+    // gain, noise suppression, the clipper and the plugin state can't be
+    // morphed: when any of them changes, the output fades out over a buffer,
+    // they are applied at silence (the plugin with the callback held off),
+    // and it fades back in. The plugin state is only restored into the
+    // plugin it was taken from.
+    Snapshot getSnapshot() const;
+    void recallSnapshot(const Snapshot& snapshot, double crossfadeMs);
     
     void loadPlugin(const juce::File& pluginFile);
     void removePlugin();
     
-    juce::StringArray getAvailableInputDevices();
-    juce::StringArray getAvailableOutputDevices();
+    // Session persistence: the description identifies the plugin without a
+    // rescan, and the state is applied before the instance joins the chain.
+    // Instantiation is posted to the message thread (VST3 requires it), so
+    // this returns immediately; onRestored gets the outcome.
+    std::unique_ptr<juce::XmlElement> getPluginDescriptionXml() const;
+    juce::MemoryBlock getPluginState() const;
+    void restorePlugin(const juce::PluginDescription& description,
+                       const juce::MemoryBlock& state,
+                       std::function<void(bool restored)> onRestored);
+    
+    void loadImpulseResponse(const juce::File& irFile);
+    void clearImpulseResponse();
+    
+    // Cached lists from the background device scan; empty until the first
+    // scan completes (see getDeviceRegistry().onDevicesChanged).
+    juce::StringArray getAvailableInputDevices() const;
+    juce::StringArray getAvailableOutputDevices() const;
+    DeviceRegistry& getDeviceRegistry() { return deviceRegistry; }
     float getCurrentBoostGain() const { return boostGainDb; }
     float getBassGain() const { return bassGainDb; }
     float getMidGain() const { return midGainDb; }
     float getTrebleGain() const { return trebleGainDb; }
+    bool isLinearPhaseEQ() const { return linearPhaseRequested.load(); }
+    bool isNoiseSuppressionEnabled() const { return noiseSuppressionEnabled.load(); }
+    NoiseSuppressor::Mode getNoiseSuppressionMode() const { return noiseSuppressor.getMode(); }
+    float getNoiseReduction() const { return noiseSuppressor.getReduction(); }
+    bool isNoiseLearning() const { return noiseSuppressor.isLearning(); }
+    bool isClipperEnabled() const { return clipperEnabled.load(); }
+    StageOversampler::Factor getStageOversampling(OversampledStage stage) const;
+    
+    // Processing latency added by the chain (excluding the device and any
+    // plugin), for downstream alignment.
+    int getLatencySamples() const;
+    
+    // Channels the chain is running: the device's active inputs (at least
+    // two, so a mono mic still feeds a stereo output), up to maxProcessChannels.
+    int getNumProcessChannels() const { return numProcessChannels; }
+    static constexpr int maxProcessChannels = BiquadCascade::maxChannels;
+    
+    // ISA variant of the DSP kernels picked for this CPU (e.g. "avx2").
+    const char* getDspKernelVariant() const { return kernels.name; }
+    // Background music and other sources mixed under the mic, with ducking.
+    DuckingMixer& getMixer() { return mixer; }
+    
     bool hasPluginLoaded() const { return pluginInstance != nullptr; }
     juce::String getPluginName() const;
+    bool hasImpulseResponseLoaded() const { return impulseResponseLoaded.load(); }
+    juce::File getImpulseResponseFile() const { return impulseResponseFile; }
     float getCurrentInputLevel() const { return inputLevel.load(); }
     float getCurrentOutputLevel() const { return outputLevel.load(); }
+    float getLastDeviceSwitchGapMs() const { return lastSwitchGapMs.load(); }
+    juce::String getCurrentInputDeviceName() const;
+    juce::String getCurrentOutputDeviceName() const;
+    double getDeviceSampleRate() const;
+    int getDeviceBufferSize() const;
+    
+    // Millisecond counter at the first audio callback, 0 until then.
+    double getFirstAudioTimeMs() const { return firstAudioTimeMs.load(); }
+    
+    bool isAutoGainEnabled() const { return autoGainEnabled.load(); }
+    float getAutoGainTarget() const { return autoGainTargetLufs.load(); }
+    float getAutoGainDb() const { return autoGainDbPublished.load(); }
+    float getShortTermLoudness() const { return loudnessMeter.getShortTermLoudness(); }
+    float getIntegratedLoudness() const { return loudnessMeter.getIntegratedLoudness(); }
     
 private:
-    void updateEQFilters();
+    void processChunk(const float* const* inputChannelData, int numInputChannels,
+                      float* const* outputChannelData, int numOutputChannels, int numSamples);
+    int getProcessingBlockSize() const;
+    void prepareProcessing(double sampleRate, int blockSize, int numChannels);
+    void applyDeviceSetup(const juce::AudioDeviceManager::AudioDeviceSetup& setup);
+    void fadeOutForDeviceChange();
+    void applyDeviceFade(int numSamples);
+    void switchWithFade(const std::function<void()>& change);
+    void applyStageOversampling(OversampledStage stage);
+    StageOversampler::Factor getEffectiveOversampling(OversampledStage stage) const;
+    void addOverloadSteps();
+    void prefaultBuffers();
+    void publishMetrics(int numSamples, juce::int64 startTicks) noexcept;
+    struct ToneState
+    {
+        float boostDb = 0.0f;
+        float bassDb = 0.0f;
+        float midDb = 0.0f;
+        float trebleDb = 0.0f;
+    };
+    
+    void postToneChange(double rampMs);
+    void updateTone(int numSamples);
+    void updateEQFilters(const ToneState& tone);
+    void updateAutoGain(int stepsCompleted);
+    
+    // The chain up to the clipper, specialised at compile time on the channel
+    // count (2, 8 or any) and on which optional stages run, so inactive ones
+    // cost nothing; processChunk picks the variant from the live
+    // configuration every block. With flat EQ, no denoiser and no plugin the
+    // input copy and the boost collapse into one copy-with-gain pass.
+    enum ChainStage : unsigned
+    {
+        stageDenoise = 1u << 0,
+        stageGain = 1u << 1,
+        stageEQ = 1u << 2,
+        stagePlugin = 1u << 3,
+        numStageCombinations = 1u << 4
+    };
+    
+    using ChainVariant = void (AudioEngine::*)(const float* const* inputs, int numInputs, int numSamples, float targetGain);
+    
+    template <int NumChannels, unsigned Stages>
+    void runChain(const float* const* inputs, int numInputs, int numSamples, float targetGain);
+    
+    template <int NumChannels, size_t... Stages>
+    static constexpr std::array<ChainVariant, sizeof...(Stages)> makeChainVariants(std::index_sequence<Stages...>)
+    {
+        return { &AudioEngine::runChain<NumChannels, (unsigned)Stages>... };
+    }
     
+    static const std::array<std::array<ChainVariant, numStageCombinations>, 3> chainVariants;
+    unsigned getActiveStages(int numSamples, float targetGain);
+    void processLinearPhaseEQ(int numSamples);
+    void processClipper(int numSamples);
+    void processPlugin(int numSamples);
+    void preparePlugin();
+    void installPlugin(std::unique_ptr<juce::AudioPluginInstance> instance, const juce::MemoryBlock* state,
+                       StageOversampler::Factor factor);
+    
+    const DspKernels::Table& kernels { DspKernels::get() };
+    ScopedMtaUsage mtaUsage;   // outlives the device the init thread opens
     juce::AudioDeviceManager deviceManager;
+    DeviceRegistry deviceRegistry { deviceManager };
+    bool usingVirtualDevice = false;
+    RealtimeTuning realtimeTuning;
+    OverloadGovernor overloadGovernor;
+    bool overloadGovernorEnabled = true;
+    std::thread initThread;
+    std::atomic<bool> initialized { false };
+    std::atomic<double> firstAudioTimeMs { 0.0 };
     std::unique_ptr<juce::AudioPluginInstance> pluginInstance;
+    int pluginGeneration = 0;   // bumped on every install/remove (message thread)
     juce::AudioPluginFormatManager pluginFormatManager;
     
+    // Requested values (message thread).
     float boostGainDb = 0.0f;
-    float currentGain = 1.0f;
     float bassGainDb = 0.0f;
     float midGainDb = 0.0f;
     float trebleGainDb = 0.0f;
     
-    juce::dsp::IIR::Filter<float> bassFilterL, bassFilterR;
-    juce::dsp::IIR::Filter<float> midFilterL, midFilterR;
-    juce::dsp::IIR::Filter<float> trebleFilterL, trebleFilterR;
+    // Boost and EQ gains as the audio thread applies them. Changes are handed
+    // over as a whole through a spin-locked slot the callback only try-locks,
+    // then ramped, with the biquads recomputed in place (no allocation).
+    static constexpr double toneSmoothingMs = 20.0;
+    juce::SpinLock toneLock;
+    ToneState pendingTone;
+    double pendingToneRampMs = 0.0;
+    std::atomic<bool> tonePending { false };
+    ToneState liveTone, toneFrom, toneTo;
+    int toneRampPosition = 0;
+    int toneRampLength = 0;
+    float appliedGain = 1.0f;
+    
+    // Samples the EQ keeps running after going flat, so its state has decayed
+    // by the time it is cleared and bypassed.
+    static constexpr double eqTailSeconds = 0.1;
+    int eqTailRemaining = 0;
+    
+    // Bass, mid and treble across all channels.
+    BiquadCascade toneFilters;
+    
+    // Runs ahead of the boost so its noise profile doesn't move with the gain.
+    NoiseSuppressor noiseSuppressor;
+    std::atomic<bool> noiseSuppressionEnabled { false };
+    bool noiseSuppressionRunning = false;   // audio thread
+    
+    // What the overload governor has taken out; the requested settings (and
+    // so the UI and presets) are left as they are. Oversampling is shed one
+    // factor at a time, and the denoiser bypasses itself (setBypassed()).
+    std::atomic<bool> linearPhaseShed { false };
+    std::array<std::atomic<int>, 2> oversamplingShed {};   // factor steps
+    std::array<std::atomic<int>, 2> oversamplingRequested {};
+    
+    // Linear-phase EQ runs alongside the IIRs and is switched in once its
+    // convolution has been fed a full FIR length of audio. The two paths are
+    // half an FIR apart in time, so they are never mixed: the output dips
+    // out, swaps and comes back in. Like the IR below it covers every
+    // channel of the chain, so all of them get the same delay.
+    LinearPhaseEQ linearPhaseEQ;
+    juce::AudioBuffer<float> linearPhaseBuffer;
+    std::atomic<bool> linearPhaseRequested { false };
+    bool linearPhaseRunning = false;
+    int linearPhaseWarmup = 0;
+    bool linearPhaseOutput = false;        // FIR path is the one playing
+    float linearPhaseSwapGain = 1.0f;
+    
+    // Uniformly partitioned at the device block size: every callback costs
+    // one FFT pair plus one multiply-add per partition, so even multi-second
+    // IRs have a flat per-block cost. File reading and FFT preparation run on
+    // a background thread and are swapped in atomically.
+    // A cleared or replaced IR leaves its tail in the convolution state;
+    // the audio thread resets it before the next block it convolves.
+    MultichannelConvolution irConvolution;
+    std::atomic<bool> impulseResponseLoaded { false };
+    std::atomic<bool> impulseResponseResetPending { false };
+    juce::File impulseResponseFile;
+    
+    // Output safety clipper and the plugin slot are the nonlinear stages;
+    // each has its own oversampler, engaged only while the stage is active.
+    std::atomic<bool> clipperEnabled { false };
+    StageOversampler clipperOversampler;
+    StageOversampler pluginOversampler;
+    juce::AudioBuffer<float> pluginBlockView;   // what the plugin is handed, no allocation
     
     double currentSampleRate = 44100.0;
+    int currentBufferSize = 512;
+    int numProcessChannels = 2;
+    int chainChannelVariant = 0;   // index into chainVariants
+    int deviceBufferSize = 512;
+    
+    static constexpr int maxDeviceChannels = 64;
+    std::atomic<int> internalBlockSize { 0 };
+    int schedulerBlockSize = 0;
+    bool schedulerBuffered = false;
+    juce::AudioBuffer<float> schedulerInput, schedulerOutput;
+    int schedulerInputCount = 0;
+    int schedulerOutputCount = 0;
+    
     juce::AudioBuffer<float> pluginBuffer;
     juce::MidiBuffer midiBuffer;
     
+    // Device switches fade the output out, swap the device and fade back in,
+    // keeping all processing state when the spec is unchanged.
+    enum FadeState { running = 0, fadingOut, silent, fadingIn };
+    std::atomic<int> fadeState { running };
+    std::atomic<double> switchStartMs { 0.0 };
+    std::atomic<float> lastSwitchGapMs { 0.0f };
+    bool isPrepared = false;
+    juce::CriticalSection switchLock;   // one faded switch at a time
+    
     std::atomic<float> inputLevel { 0.0f };
     std::atomic<float> outputLevel { 0.0f };
     
+    // Auto gain: the meter sits at the end of the chain and the boost is
+    // nudged toward the target once per 100 ms step while someone is talking.
+    LoudnessMeter loudnessMeter;
+    std::atomic<bool> autoGainEnabled { false };
+    std::atomic<float> autoGainTargetLufs { -18.0f };
+    std::atomic<float> autoGainMinDb { -10.0f };
+    std::atomic<float> autoGainMaxDb { 30.0f };
+    std::atomic<float> autoGainDbPublished { 0.0f };
+    float autoGainDb = 0.0f;
+    bool autoGainWasEnabled = false;
+    
+    // Network audio; the receiver is a mixer source, so it outlives the mixer.
+    RtpAudioSender networkSender;
+    std::atomic<bool> networkSenderLive { true };   // false while it's reconfigured
+    RtpAudioReceiver networkReceiver;
+    
+    // Mixed in after the loudness meter, so auto gain only hears the mic.
+    DuckingMixer mixer { kernels };
+    
+    // Live metrics; the device pointer is only read between start and stop.
+    MetricsPublisher metricsPublisher;
+    juce::AudioIODevice* runningDevice = nullptr;
+    float clipperReductionDb = 0.0f;
+    
+    JUCE_DECLARE_WEAK_REFERENCEABLE(AudioEngine)
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioEngine)
 };
@@ -0,0 +1,46 @@
+#include "BiquadCascade.h"
+#include <cstring>
+
+void BiquadCascade::prepare(int newNumChannels, int maxBlockSize)
+{
+    numChannels = juce::jlimit(1, maxChannels, newNumChannels);
+    maxSamples = juce::jmax(1, maxBlockSize);
+    kernels = &DspKernels::get();
+    frames.assign((size_t)(numChannels * maxSamples), 0.0f);
+    reset();
+}
+
+void BiquadCascade::reset()
+{
+    std::memset(z1, 0, sizeof(z1));
+    std::memset(z2, 0, sizeof(z2));
+}
+
+void BiquadCascade::setCoefficients(int stage, const std::array<float, 6>& c)
+{
+    const float a0 = c[3] != 0.0f ? c[3] : 1.0f;
+    stages[(size_t)stage] = { c[0] / a0, c[1] / a0, c[2] / a0, c[4] / a0, c[5] / a0 };
+}
+
+void BiquadCascade::process(float* const* channels, int numSamples)
+{
+    jassert(numSamples <= maxSamples);
+    const int n = numChannels;
+    float* const frameData = frames.data();
+    
+    for (int ch = 0; ch < n; ++ch)
+    {
+        const float* src = channels[ch];
+        for (int i = 0; i < numSamples; ++i)
+            frameData[i * n + ch] = src[i];
+    }
+    
+    kernels->biquadFrames(frameData, numSamples, n, stages.data(), numStages, &z1[0][0], &z2[0][0], maxChannels);
+    
+    for (int ch = 0; ch < n; ++ch)
+    {
+        float* dst = channels[ch];
+        for (int i = 0; i < numSamples; ++i)
+            dst[i] = frameData[i * n + ch];
+    }
+}
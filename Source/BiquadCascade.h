@@ -0,0 +1,40 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include "DspKernels.h"
+#include <array>
+#include <vector>
+
+// The tone EQ's biquads (transposed direct form II) for any number of
+// channels up to maxChannels. Coefficients are shared across channels and
+// the filter state is kept per stage as one array indexed by channel, so a
+// block is run frame by frame through an interleaved scratch buffer and the
+// per-sample work is a straight loop across channels (DspKernels'
+// biquadFrames, vectorised at the widest ISA the CPU has) rather than one
+// filter object per channel.
+class BiquadCascade
+{
+public:
+    static constexpr int numStages = 3;
+    static constexpr int maxChannels = 8;
+    
+    // Allocates the scratch buffer and clears the state.
+    void prepare(int numChannels, int maxBlockSize);
+    void reset();
+    
+    // b0 b1 b2 a0 a1 a2, as returned by IIR::ArrayCoefficients. The state
+    // is kept, so coefficients can be moved while audio is running.
+    void setCoefficients(int stage, const std::array<float, 6>& coefficients);
+    
+    void process(float* const* channels, int numSamples);
+    
+    int getNumChannels() const { return numChannels; }
+    
+private:
+    const DspKernels::Table* kernels = nullptr;
+    std::array<DspKernels::BiquadCoefficients, numStages> stages;
+    alignas(32) float z1[numStages][maxChannels] {};
+    alignas(32) float z2[numStages][maxChannels] {};
+    std::vector<float> frames;
+    int numChannels = 0;
+    int maxSamples = 0;
+};
@@ -0,0 +1,119 @@
+#include "DeviceRegistry.h"
+#include "ScopedComInitialiser.h"
+
+DeviceRegistry::DeviceRegistry(juce::AudioDeviceManager& manager)
+    : Thread("DeviceRegistry"), deviceManager(manager)
+{
+    deviceManager.addChangeListener(this);
+    refresh();
+    startThread(juce::Thread::Priority::low);
+}
+
+DeviceRegistry::~DeviceRegistry()
+{
+    deviceManager.removeChangeListener(this);
+    cancelPendingUpdate();
+    signalThreadShouldExit();
+    notify();
+    stopThread(5000);
+}
+
+void DeviceRegistry::refresh()
+{
+    // Until the manager has opened a backend this is empty, and the scan
+    // uses the first platform type, which is the manager's default too.
+    {
+        const juce::ScopedLock sl(listLock);
+        wantedTypeName = deviceManager.getCurrentAudioDeviceType();
+    }
+    
+    rescanRequested.store(true);
+    notify();
+}
+
+void DeviceRegistry::addDeviceType(std::unique_ptr<juce::AudioIODeviceType> type)
+{
+    {
+        const juce::ScopedLock sl(listLock);
+        addedTypes.add(type.release());
+    }
+    refresh();
+}
+
+juce::StringArray DeviceRegistry::getInputDevices() const
+{
+    const juce::ScopedLock sl(listLock);
+    return inputDevices;
+}
+
+juce::StringArray DeviceRegistry::getOutputDevices() const
+{
+    const juce::ScopedLock sl(listLock);
+    return outputDevices;
+}
+
+void DeviceRegistry::run()
+{
+    const ScopedComInitialiser com;
+    
+    while (!threadShouldExit())
+    {
+        if (rescanRequested.exchange(false))
+            scan();
+        else
+            wait(-1);
+    }
+}
+
+void DeviceRegistry::scan()
+{
+    // createAudioDeviceTypes() only builds fresh objects; it doesn't touch
+    // the manager's own.
+    if (scannerTypes.isEmpty())
+        deviceManager.createAudioDeviceTypes(scannerTypes);
+    
+    juce::String currentTypeName;
+    {
+        const juce::ScopedLock sl(listLock);
+        currentTypeName = wantedTypeName;
+        while (!addedTypes.isEmpty())
+            scannerTypes.add(addedTypes.removeAndReturn(0));
+    }
+    
+    // Follow whichever backend the manager ends up using.
+    auto* scanner = scannerTypes.getFirst();
+    for (auto* type : scannerTypes)
+        if (type->getTypeName() == currentTypeName)
+            scanner = type;
+    
+    if (scanner == nullptr)
+        return;
+    
+    scanner->scanForDevices();
+    auto inputs = scanner->getDeviceNames(true);
+    auto outputs = scanner->getDeviceNames(false);
+    
+    bool changed;
+    {
+        const juce::ScopedLock sl(listLock);
+        changed = !scanned.load() || inputs != inputDevices || outputs != outputDevices;
+        inputDevices = inputs;
+        outputDevices = outputs;
+    }
+    
+    scanned.store(true);
+    
+    if (changed)
+        triggerAsyncUpdate();
+}
+
+void DeviceRegistry::changeListenerCallback(juce::ChangeBroadcaster*)
+{
+    refresh();
+}
+
+void DeviceRegistry::handleAsyncUpdate()
+{
+    if (onDevicesChanged)
+        onDevicesChanged();
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <juce_audio_devices/juce_audio_devices.h>
+
+// Cached device lists. Scans run on a background thread against private
+// AudioIODeviceType instances, so hardware enumeration never blocks the
+// message thread or fights the device manager over its own type objects;
+// the manager itself is only queried on the message thread.
+// Any change broadcast by the AudioDeviceManager (which includes hot-plug
+// notifications) triggers a rescan; listeners only hear about it when the
+// lists actually differ.
+class DeviceRegistry : private juce::Thread,
+                       private juce::ChangeListener,
+                       private juce::AsyncUpdater
+{
+public:
+    explicit DeviceRegistry(juce::AudioDeviceManager& manager);
+    ~DeviceRegistry() override;
+    
+    // Message thread.
+    void refresh();
+    
+    // Message thread, for types registered with the manager by hand (the
+    // virtual device): a separate instance the scans can use.
+    void addDeviceType(std::unique_ptr<juce::AudioIODeviceType> type);
+    
+    bool hasScanned() const { return scanned.load(); }
+    juce::StringArray getInputDevices() const;
+    juce::StringArray getOutputDevices() const;
+    
+    // Called on the message thread after a scan that changed the lists.
+    std::function<void()> onDevicesChanged;
+    
+private:
+    void run() override;
+    void scan();
+    void changeListenerCallback(juce::ChangeBroadcaster*) override;
+    void handleAsyncUpdate() override;
+    
+    juce::AudioDeviceManager& deviceManager;
+    juce::OwnedArray<juce::AudioIODeviceType> scannerTypes;   // scan thread only
+    
+    // Message thread -> scan thread, under listLock.
+    juce::String wantedTypeName;
+    juce::OwnedArray<juce::AudioIODeviceType> addedTypes;
+    
+    mutable juce::CriticalSection listLock;
+    juce::StringArray inputDevices;
+    juce::StringArray outputDevices;
+    
+    std::atomic<bool> scanned { false };
+    std::atomic<bool> rescanRequested { true };
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeviceRegistry)
+};
@@ -0,0 +1,32 @@
+#include <juce_core/juce_core.h>
+#include "DspKernels.h"
+
+namespace
+{
+    const DspKernels::Table& selectTable()
+    {
+        const DspKernels::Table* candidates[3] = { &DspKernels::getBaselineTable() };
+        int numCandidates = 1;
+
+#if MICBOOSTER_KERNELS_X86
+        if (juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3())
+            candidates[numCandidates++] = &DspKernels::getAvx2Table();
+        if (juce::SystemStats::hasAVX512F() && juce::SystemStats::hasAVX512VL() && juce::SystemStats::hasFMA3())
+            candidates[numCandidates++] = &DspKernels::getAvx512Table();
+#endif
+
+        // A pinned variant is only honoured if this CPU can run it.
+        const auto pinned = juce::SystemStats::getEnvironmentVariable("MICBOOSTER_DSP_KERNELS", {}).trim();
+        for (int i = 0; i < numCandidates; ++i)
+            if (pinned.equalsIgnoreCase(candidates[i]->name))
+                return *candidates[i];
+        
+        return *candidates[numCandidates - 1];
+    }
+}
+
+const DspKernels::Table& DspKernels::get()
+{
+    static const Table& selected = selectTable();
+    return selected;
+}
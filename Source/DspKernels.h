@@ -0,0 +1,55 @@
+#pragma once
+
+// The chain's inner loops, built once per instruction set (baseline, AVX2
+// and AVX-512 on x86-64; NEON is the aarch64 baseline) from the same source
+// in DspKernelsImpl.h. get() picks the best variant the CPU supports the
+// first time it's called; call it once off the audio thread. Setting
+// MICBOOSTER_DSP_KERNELS to a variant name pins it, e.g. to compare speed or
+// to render bit-identical output across machines.
+//
+// Deliberately free of JUCE and standard library includes: the variant
+// translation units are compiled with wider ISA flags, and any inline
+// function they shared with the rest of the program could be emitted with
+// those instructions and picked by the linker for everyone.
+namespace DspKernels
+{
+    struct BiquadCoefficients
+    {
+        float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f, a1 = 0.0f, a2 = 0.0f;
+    };
+    
+    struct Table
+    {
+        const char* name;
+        
+        // data *= gain, with gain ramped linearly from startGain (as
+        // AudioBuffer::applyGainRamp).
+        void (*applyGainRamp)(float* data, int numSamples, float startGain, float endGain);
+        
+        // dest = src * gain, ramped the same way; one pass instead of a copy
+        // followed by applyGainRamp.
+        void (*copyWithGainRamp)(float* dest, const float* src, int numSamples, float startGain, float endGain);
+        
+        // dest += src * gain, ramped the same way (mixing a source in).
+        void (*addWithGainRamp)(float* dest, const float* src, int numSamples, float startGain, float endGain);
+        
+        // Largest absolute sample value.
+        float (*peakMagnitude)(const float* data, int numSamples);
+        
+        // Cascaded transposed-DF2 biquads over interleaved frames, one lane
+        // per channel; z1/z2 hold numStages rows of stateStride floats. 1, 2,
+        // 4 and 8 channels run fixed-width specialisations.
+        void (*biquadFrames)(float* frames, int numFrames, int numChannels,
+                             const BiquadCoefficients* stages, int numStages,
+                             float* z1, float* z2, int stateStride);
+    };
+    
+    const Table& get();
+    
+    // Variant tables, defined by the per-ISA translation units.
+    const Table& getBaselineTable();
+#if MICBOOSTER_KERNELS_X86
+    const Table& getAvx2Table();
+    const Table& getAvx512Table();
+#endif
+}
@@ -0,0 +1,5 @@
+// Built with AVX2/FMA enabled (see CMakeLists.txt); only called once
+// DspKernels.cpp has checked the CPU supports it.
+#include "DspKernelsImpl.h"
+
+MICBOOSTER_DEFINE_KERNEL_TABLE(getAvx2Table, "avx2")
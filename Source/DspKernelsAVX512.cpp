@@ -0,0 +1,5 @@
+// Built with AVX-512F/VL enabled (see CMakeLists.txt); only called once
+// DspKernels.cpp has checked the CPU supports it.
+#include "DspKernelsImpl.h"
+
+MICBOOSTER_DEFINE_KERNEL_TABLE(getAvx512Table, "avx512")
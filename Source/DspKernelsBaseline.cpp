@@ -0,0 +1,11 @@
+#include "DspKernelsImpl.h"
+
+// Baseline variant, built with the project's default flags, so it runs on
+// any CPU the rest of the program does.
+#if MICBOOSTER_KERNELS_X86
+MICBOOSTER_DEFINE_KERNEL_TABLE(getBaselineTable, "sse2")
+#elif defined(__aarch64__) || defined(_M_ARM64)
+MICBOOSTER_DEFINE_KERNEL_TABLE(getBaselineTable, "neon")
+#else
+MICBOOSTER_DEFINE_KERNEL_TABLE(getBaselineTable, "generic")
+#endif
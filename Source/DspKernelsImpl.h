@@ -0,0 +1,130 @@
+#pragma once
+#include "DspKernels.h"
+
+// Kernel bodies shared by every ISA variant. Include from exactly one
+// translation unit per variant and expand MICBOOSTER_DEFINE_KERNEL_TABLE
+// there; everything here has internal linkage, so each variant keeps the
+// code its own compiler flags produced. Plain loops, written so the
+// compiler can vectorise them at whatever width the flags allow.
+namespace
+{
+    inline float absolute(float x) { return x < 0.0f ? -x : x; }
+    
+    void applyGainRampKernel(float* data, int numSamples, float startGain, float endGain)
+    {
+        if (startGain == endGain)
+        {
+            for (int i = 0; i < numSamples; ++i)
+                data[i] *= startGain;
+            return;
+        }
+        
+        const float increment = (endGain - startGain) / (float)numSamples;
+        for (int i = 0; i < numSamples; ++i)
+            data[i] *= startGain + increment * (float)i;
+    }
+    
+    void copyWithGainRampKernel(float* dest, const float* src, int numSamples, float startGain, float endGain)
+    {
+        if (startGain == endGain)
+        {
+            for (int i = 0; i < numSamples; ++i)
+                dest[i] = src[i] * startGain;
+            return;
+        }
+        
+        const float increment = (endGain - startGain) / (float)numSamples;
+        for (int i = 0; i < numSamples; ++i)
+            dest[i] = src[i] * (startGain + increment * (float)i);
+    }
+    
+    void addWithGainRampKernel(float* dest, const float* src, int numSamples, float startGain, float endGain)
+    {
+        if (startGain == endGain)
+        {
+            for (int i = 0; i < numSamples; ++i)
+                dest[i] += src[i] * startGain;
+            return;
+        }
+        
+        const float increment = (endGain - startGain) / (float)numSamples;
+        for (int i = 0; i < numSamples; ++i)
+            dest[i] += src[i] * (startGain + increment * (float)i);
+    }
+    
+    float peakMagnitudeKernel(const float* data, int numSamples)
+    {
+        // Independent lanes, so the reduction vectorises without fast-math.
+        constexpr int lanes = 16;
+        float peaks[lanes] = {};
+        
+        int i = 0;
+        for (; i + lanes <= numSamples; i += lanes)
+            for (int k = 0; k < lanes; ++k)
+            {
+                const float m = absolute(data[i + k]);
+                peaks[k] = m > peaks[k] ? m : peaks[k];
+            }
+        
+        float peak = 0.0f;
+        for (; i < numSamples; ++i)
+            peak = absolute(data[i]) > peak ? absolute(data[i]) : peak;
+        for (int k = 0; k < lanes; ++k)
+            peak = peaks[k] > peak ? peaks[k] : peak;
+        return peak;
+    }
+    
+    // FixedChannels > 0 makes the lane loop a compile-time trip count, so it
+    // becomes straight vector code; 0 is the any-width fallback.
+    template <int FixedChannels>
+    void runBiquadFrames(float* frames, int numFrames, int numChannels,
+                         const DspKernels::BiquadCoefficients* stages, int numStages,
+                         float* z1, float* z2, int stateStride)
+    {
+        const int lanes = FixedChannels > 0 ? FixedChannels : numChannels;
+        
+        for (int i = 0; i < numFrames; ++i)
+        {
+            float* const x = frames + i * lanes;
+            
+            for (int s = 0; s < numStages; ++s)
+            {
+                const DspKernels::BiquadCoefficients c = stages[s];
+                float* const s1 = z1 + s * stateStride;
+                float* const s2 = z2 + s * stateStride;
+                
+                for (int ch = 0; ch < lanes; ++ch)
+                {
+                    const float in = x[ch];
+                    const float out = c.b0 * in + s1[ch];
+                    s1[ch] = c.b1 * in - c.a1 * out + s2[ch];
+                    s2[ch] = c.b2 * in - c.a2 * out;
+                    x[ch] = out;
+                }
+            }
+        }
+    }
+    
+    void biquadFramesKernel(float* frames, int numFrames, int numChannels,
+                            const DspKernels::BiquadCoefficients* stages, int numStages,
+                            float* z1, float* z2, int stateStride)
+    {
+        switch (numChannels)
+        {
+            case 1:  runBiquadFrames<1>(frames, numFrames, 1, stages, numStages, z1, z2, stateStride); break;
+            case 2:  runBiquadFrames<2>(frames, numFrames, 2, stages, numStages, z1, z2, stateStride); break;
+            case 4:  runBiquadFrames<4>(frames, numFrames, 4, stages, numStages, z1, z2, stateStride); break;
+            case 8:  runBiquadFrames<8>(frames, numFrames, 8, stages, numStages, z1, z2, stateStride); break;
+            default: runBiquadFrames<0>(frames, numFrames, numChannels, stages, numStages, z1, z2, stateStride); break;
+        }
+    }
+}
+
+#define MICBOOSTER_DEFINE_KERNEL_TABLE(getterName, variantName) \
+    const DspKernels::Table& DspKernels::getterName() \
+    { \
+        static const Table table { variantName, applyGainRampKernel, copyWithGainRampKernel, \
+                                   addWithGainRampKernel, peakMagnitudeKernel, \
+                                   biquadFramesKernel }; \
+        return table; \
+    }
@@ -0,0 +1,234 @@
+#include "DuckingMixer.h"
+#include <cmath>
+
+DuckingMixer::DuckingMixer(const DspKernels::Table& k) : kernels(k)
+{
+    formatManager.registerBasicFormats();
+    
+    for (auto& source : sources)
+        source.player = std::make_unique<LoopingFilePlayer>(readAheadThread);
+}
+
+DuckingMixer::~DuckingMixer()
+{
+    readAheadThread.stopThread(2000);
+}
+
+void DuckingMixer::prepare(double newSampleRate, int newMaxBlockSize, int numChannels)
+{
+    juce::ignoreUnused(numChannels);
+    sampleRate = newSampleRate;
+    maxBlockSize = newMaxBlockSize;
+    segmentGains.assign((size_t)(maxBlockSize / segmentSize + 2), 1.0f);
+    
+    for (auto& source : sources)
+    {
+        source.buffer.setSize(maxSourceChannels, maxBlockSize);
+        source.player->prepare(sampleRate, maxBlockSize);
+    }
+    prepared = true;
+}
+
+void DuckingMixer::setDeviceSource(int slot, int firstChannel, int numChannels)
+{
+    auto& source = sources[(size_t)slot];
+    clearSource(slot);
+    
+    source.firstChannel.store(juce::jmax(0, firstChannel));
+    source.numChannels.store(juce::jlimit(1, maxSourceChannels, numChannels));
+    source.type.store((int)SourceType::deviceChannels);
+}
+
+bool DuckingMixer::setFileSource(int slot, const juce::File& file)
+{
+    auto* reader = formatManager.createReaderFor(file);
+    if (reader == nullptr)
+        return false;
+    
+    auto& source = sources[(size_t)slot];
+    clearSource(slot);
+    
+    if (!readAheadThread.isThreadRunning())
+        readAheadThread.startThread(juce::Thread::Priority::normal);
+    
+    source.player->setReader(reader);
+    source.player->start();
+    source.file = file;
+    source.numChannels.store(maxSourceChannels);
+    source.type.store((int)SourceType::file);
+    return true;
+}
+
+void DuckingMixer::setNetworkSource(int slot, RtpAudioReceiver* receiver)
+{
+    auto& source = sources[(size_t)slot];
+    clearSource(slot);
+    
+    source.receiver.store(receiver);
+    source.numChannels.store(maxSourceChannels);
+    source.type.store((int)SourceType::network);
+}
+
+void DuckingMixer::clearSource(int slot)
+{
+    auto& source = sources[(size_t)slot];
+    source.type.store((int)SourceType::off);
+    
+    // The callback only ever touches the player's FIFO, which stays put.
+    source.player->stop();
+    source.player->setReader(nullptr);
+    source.file = juce::File();
+}
+
+void DuckingMixer::setFilePlaying(int slot, bool shouldPlay)
+{
+    auto& player = *sources[(size_t)slot].player;
+    if (shouldPlay)
+        player.start();
+    else
+        player.stop();
+}
+
+void DuckingMixer::setFilePosition(int slot, double seconds)
+{
+    sources[(size_t)slot].player->setPosition(seconds);
+}
+
+void DuckingMixer::setSourceGain(int slot, float gainDb)
+{
+    sources[(size_t)slot].gainDb.store(gainDb);
+}
+
+void DuckingMixer::setSourceDucked(int slot, bool shouldBeDucked)
+{
+    sources[(size_t)slot].ducked.store(shouldBeDucked);
+}
+
+void DuckingMixer::setDucker(const DuckerSettings& settings)
+{
+    thresholdDb.store(settings.thresholdDb);
+    depthDb.store(juce::jmax(0.0f, settings.depthDb));
+    attackMs.store(juce::jmax(0.1f, settings.attackMs));
+    releaseMs.store(juce::jmax(0.1f, settings.releaseMs));
+}
+
+DuckingMixer::DuckerSettings DuckingMixer::getDucker() const
+{
+    return { thresholdDb.load(), depthDb.load(), attackMs.load(), releaseMs.load() };
+}
+
+int DuckingMixer::getNumMicInputs(int numDeviceInputs) const
+{
+    int micInputs = numDeviceInputs;
+    for (auto& source : sources)
+        if (source.type.load() == (int)SourceType::deviceChannels)
+            micInputs = juce::jmin(micInputs, source.firstChannel.load());
+    
+    return juce::jmax(1, micInputs);
+}
+
+void DuckingMixer::updateDuckGains(const juce::AudioBuffer<float>& mix, int numSamples)
+{
+    const float attack = std::exp(-(float)segmentSize / (attackMs.load() * 0.001f * (float)sampleRate));
+    const float release = std::exp(-(float)segmentSize / (releaseMs.load() * 0.001f * (float)sampleRate));
+    const float threshold = thresholdDb.load();
+    const float depth = depthDb.load();
+    
+    segmentGains[0] = duckGain;
+    
+    for (int pos = 0, segment = 1; pos < numSamples; pos += segmentSize, ++segment)
+    {
+        const int length = juce::jmin(segmentSize, numSamples - pos);
+        
+        float peak = 0.0f;
+        for (int ch = 0; ch < mix.getNumChannels(); ++ch)
+            peak = juce::jmax(peak, kernels.peakMagnitude(mix.getReadPointer(ch, pos), length));
+        
+        envelope = peak + (envelope - peak) * (peak > envelope ? attack : release);
+        
+        const float over = juce::Decibels::gainToDecibels(envelope) - threshold;
+        duckGain = juce::Decibels::decibelsToGain(-depth * juce::jlimit(0.0f, 1.0f, over / kneeDb));
+        segmentGains[(size_t)segment] = duckGain;
+    }
+    
+    duckingDb.store(juce::Decibels::gainToDecibels(duckGain));
+}
+
+void DuckingMixer::process(juce::AudioBuffer<float>& mix, int numSamples,
+                           const float* const* deviceInputs, int numDeviceInputs)
+{
+    if (!prepared || numSamples > maxBlockSize)
+        return;
+    
+    // Follow the mic even with nothing to duck, so a source coming in
+    // mid-sentence starts at the right level.
+    updateDuckGains(mix, numSamples);
+    
+    for (auto& source : sources)
+    {
+        const int type = source.type.load();
+        if (type == (int)SourceType::off)
+        {
+            source.appliedGain = 0.0f;
+            continue;
+        }
+        
+        const float* inputs[maxSourceChannels] = {};
+        int numInputs = source.numChannels.load();
+        
+        if (type == (int)SourceType::file)
+        {
+            source.player->read(source.buffer.getArrayOfWritePointers(), numSamples);
+            for (int ch = 0; ch < numInputs; ++ch)
+                inputs[ch] = source.buffer.getReadPointer(ch);
+        }
+        else if (type == (int)SourceType::network)
+        {
+            auto* receiver = source.receiver.load();
+            if (receiver == nullptr)
+                continue;
+            
+            receiver->pull(source.buffer.getArrayOfWritePointers(), numInputs, numSamples);
+            for (int ch = 0; ch < numInputs; ++ch)
+                inputs[ch] = source.buffer.getReadPointer(ch);
+        }
+        else
+        {
+            const int first = source.firstChannel.load();
+            numInputs = juce::jmin(numInputs, numDeviceInputs - first);
+            for (int ch = 0; ch < numInputs; ++ch)
+                inputs[ch] = deviceInputs[first + ch];
+            
+            if (numInputs <= 0 || inputs[0] == nullptr || (numInputs > 1 && inputs[1] == nullptr))
+                continue;
+        }
+        
+        // Source gain ramps over the block; ducking ramps per segment on top.
+        const float startGain = source.appliedGain;
+        const float endGain = juce::Decibels::decibelsToGain(source.gainDb.load());
+        const bool ducked = source.ducked.load();
+        
+        for (int ch = 0; ch < mix.getNumChannels(); ++ch)
+        {
+            float* dest = mix.getWritePointer(ch);
+            const float* src = inputs[ch % numInputs];
+            
+            if (!ducked)
+            {
+                kernels.addWithGainRamp(dest, src, numSamples, startGain, endGain);
+                continue;
+            }
+            
+            for (int pos = 0, segment = 0; pos < numSamples; pos += segmentSize, ++segment)
+            {
+                const int end = juce::jmin(numSamples, pos + segmentSize);
+                const float g0 = startGain + (endGain - startGain) * (float)pos / (float)numSamples;
+                const float g1 = startGain + (endGain - startGain) * (float)end / (float)numSamples;
+                kernels.addWithGainRamp(dest + pos, src + pos, end - pos,
+                                        g0 * segmentGains[(size_t)segment], g1 * segmentGains[(size_t)segment + 1]);
+            }
+        }
+        
+        source.appliedGain = endGain;
+    }
+}
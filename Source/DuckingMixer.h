@@ -0,0 +1,127 @@
+#pragma once
+#include <juce_audio_devices/juce_audio_devices.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <array>
+#include <atomic>
+#include <vector>
+#include "DspKernels.h"
+#include "LoopingFilePlayer.h"
+#include "RtpAudioReceiver.h"
+
+// Mixes secondary sources under the processed mic: extra device input
+// channels (e.g. a loopback carrying the music player), a looped audio
+// file or an RTP stream from another machine. Each source has its own
+// gain, and ducked ones are pulled down by a side-chain follower on the
+// mic's envelope, so music sits back while the streamer talks and comes up
+// again in the pauses.
+//
+// The envelope is tracked per 32-sample segment and every gain change is a
+// ramp, so all mixing is done by the vectorised kernels over buffers sized
+// in prepare(). File sources are read ahead and resampled on the mixer's
+// thread into a lock-free FIFO, so the callback never waits on a reader.
+class DuckingMixer
+{
+public:
+    static constexpr int maxSources = 4;
+    static constexpr int maxSourceChannels = 2;
+    static_assert(LoopingFilePlayer::numChannels == maxSourceChannels, "file sources fill a whole source buffer");
+    
+    // Each kind of source has a slot of its own, so setting one up never
+    // replaces another.
+    static constexpr int musicSlot = 0;
+    static constexpr int deviceSlot = 1;
+    static constexpr int networkSlot = 2;
+    
+    enum class SourceType { off = 0, deviceChannels, file, network };
+    
+    struct DuckerSettings
+    {
+        float thresholdDb = -40.0f;   // mic level where ducking starts
+        float depthDb = 12.0f;        // full attenuation, reached 6 dB above
+        float attackMs = 10.0f;
+        float releaseMs = 400.0f;
+    };
+    
+    explicit DuckingMixer(const DspKernels::Table& kernels);
+    ~DuckingMixer();
+    
+    // Not on the audio thread (the engine holds the callback lock).
+    void prepare(double sampleRate, int maxBlockSize, int numChannels);
+    
+    // Message thread. Device channels are zero-based; a source reading
+    // device channels takes them away from the mic.
+    void setDeviceSource(int slot, int firstChannel, int numChannels);
+    bool setFileSource(int slot, const juce::File& file);
+    void setNetworkSource(int slot, RtpAudioReceiver* receiver);   // must outlive the mixer
+    void clearSource(int slot);
+    
+    // Message thread: pause/resume and seek a file source.
+    void setFilePlaying(int slot, bool shouldPlay);
+    void setFilePosition(int slot, double seconds);
+    void setSourceGain(int slot, float gainDb);
+    void setSourceDucked(int slot, bool shouldBeDucked);
+    
+    SourceType getSourceType(int slot) const { return (SourceType)sources[(size_t)slot].type.load(); }
+    float getSourceGain(int slot) const { return sources[(size_t)slot].gainDb.load(); }
+    bool isSourceDucked(int slot) const { return sources[(size_t)slot].ducked.load(); }
+    juce::File getSourceFile(int slot) const { return sources[(size_t)slot].file; }
+    
+    void setDucker(const DuckerSettings& settings);
+    DuckerSettings getDucker() const;
+    
+    // Attenuation applied to ducked sources in the last block, for meters.
+    float getDuckingDb() const { return duckingDb.load(); }
+    
+    // Device inputs below this belong to the mic.
+    int getNumMicInputs(int numDeviceInputs) const;
+    
+    // Audio thread: mixes every source into mix, ducked by the envelope of
+    // what mix holds on entry (the processed mic).
+    void process(juce::AudioBuffer<float>& mix, int numSamples,
+                 const float* const* deviceInputs, int numDeviceInputs);
+    
+private:
+    struct Source
+    {
+        std::atomic<int> type { (int)SourceType::off };
+        std::atomic<int> firstChannel { 0 };
+        std::atomic<int> numChannels { 0 };
+        std::atomic<float> gainDb { 0.0f };
+        std::atomic<bool> ducked { true };
+        
+        juce::File file;   // message thread
+        std::unique_ptr<LoopingFilePlayer> player;
+        juce::AudioBuffer<float> buffer;
+        
+        std::atomic<RtpAudioReceiver*> receiver { nullptr };
+        
+        float appliedGain = 0.0f;   // audio thread
+    };
+    
+    void updateDuckGains(const juce::AudioBuffer<float>& mix, int numSamples);
+    
+    static constexpr int segmentSize = 32;
+    static constexpr float kneeDb = 6.0f;
+    
+    const DspKernels::Table& kernels;
+    juce::AudioFormatManager formatManager;
+    juce::TimeSliceThread readAheadThread { "Mixer file reader" };
+    std::array<Source, maxSources> sources;
+    
+    double sampleRate = 48000.0;
+    int maxBlockSize = 0;
+    bool prepared = false;
+    
+    std::atomic<float> thresholdDb { -40.0f };
+    std::atomic<float> depthDb { 12.0f };
+    std::atomic<float> attackMs { 10.0f };
+    std::atomic<float> releaseMs { 400.0f };
+    
+    // Audio thread.
+    float envelope = 0.0f;
+    float duckGain = 1.0f;
+    std::vector<float> segmentGains;   // duck gain at each segment boundary
+    std::atomic<float> duckingDb { 0.0f };
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DuckingMixer)
+};
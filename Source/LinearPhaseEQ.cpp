@@ -0,0 +1,114 @@
+#include "LinearPhaseEQ.h"
+
+LinearPhaseEQ::LinearPhaseEQ() : Thread("LinearPhaseEQ")
+{
+    startThread(juce::Thread::Priority::low);
+}
+
+LinearPhaseEQ::~LinearPhaseEQ()
+{
+    signalThreadShouldExit();
+    notify();
+    stopThread(2000);
+}
+
+void LinearPhaseEQ::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    // ~85 ms of taps keeps the 200 Hz shelf accurate at any supported rate.
+    const int order = spec.sampleRate > 50000.0 ? 13 : 12;
+    
+    sampleRate.store(spec.sampleRate);
+    firOrder.store(order);
+    latencySamples.store((1 << order) / 2);
+    
+    convolution.prepare(spec);
+    
+    needsRebuild.store(true);
+    notify();
+}
+
+void LinearPhaseEQ::reset()
+{
+    convolution.reset();
+}
+
+void LinearPhaseEQ::process(const juce::dsp::ProcessContextReplacing<float>& context)
+{
+    convolution.process(context);
+}
+
+void LinearPhaseEQ::setBands(float bassDb, float midDb, float trebleDb)
+{
+    bassGainDb.store(bassDb);
+    midGainDb.store(midDb);
+    trebleGainDb.store(trebleDb);
+    
+    needsRebuild.store(true);
+    notify();
+}
+
+void LinearPhaseEQ::run()
+{
+    const juce::ScopedNoDenormals noDenormals;
+    
+    while (!threadShouldExit())
+    {
+        if (needsRebuild.exchange(false))
+            buildFilter();
+        else
+            wait(-1);
+    }
+}
+
+void LinearPhaseEQ::buildFilter()
+{
+    const double rate = sampleRate.load();
+    const int order = firOrder.load();
+    const int size = 1 << order;
+    
+    auto bass = juce::dsp::IIR::Coefficients<float>::makeLowShelf(
+        rate, 200.0f, 0.707f, juce::Decibels::decibelsToGain(bassGainDb.load()));
+    auto mid = juce::dsp::IIR::Coefficients<float>::makePeakFilter(
+        rate, 1000.0f, 1.0f, juce::Decibels::decibelsToGain(midGainDb.load()));
+    auto treble = juce::dsp::IIR::Coefficients<float>::makeHighShelf(
+        rate, 4000.0f, 0.707f, juce::Decibels::decibelsToGain(trebleGainDb.load()));
+    
+    // Zero-phase spectrum: magnitude only, laid out as the packed complex
+    // bins the real-only inverse FFT expects.
+    std::vector<float> spectrum((size_t)size * 2, 0.0f);
+    for (int k = 0; k <= size / 2; ++k)
+    {
+        const double freq = juce::jmax(1.0, rate * k / size);
+        const double magnitude = bass->getMagnitudeForFrequency(freq, rate)
+                               * mid->getMagnitudeForFrequency(freq, rate)
+                               * treble->getMagnitudeForFrequency(freq, rate);
+        spectrum[(size_t)k * 2] = (float)magnitude;
+    }
+    
+    juce::dsp::FFT fft(order);
+    fft.performRealOnlyInverseTransform(spectrum.data());
+    
+    // Rotate the symmetric impulse to the middle and window it.
+    juce::AudioBuffer<float> fir(1, size);
+    auto* taps = fir.getWritePointer(0);
+    double sum = 0.0;
+    for (int n = 0; n < size; ++n)
+    {
+        const float window = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * (float)n / (float)size);
+        taps[n] = spectrum[(size_t)((n + size / 2) % size)] * window;
+        sum += taps[n];
+    }
+    
+    // Pin the DC gain to the analytic value; this also makes the result
+    // independent of the FFT backend's inverse scaling.
+    const double dcGain = bass->getMagnitudeForFrequency(1.0, rate)
+                        * mid->getMagnitudeForFrequency(1.0, rate)
+                        * treble->getMagnitudeForFrequency(1.0, rate);
+    if (std::abs(sum) > 1.0e-9)
+        fir.applyGain((float)(dcGain / sum));
+    
+    convolution.loadImpulseResponse(std::move(fir), rate,
+                                    juce::dsp::Convolution::Stereo::no,
+                                    juce::dsp::Convolution::Trim::no,
+                                    juce::dsp::Convolution::Normalise::no);
+}
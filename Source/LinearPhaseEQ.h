@@ -0,0 +1,43 @@
+#pragma once
+#include <juce_dsp/juce_dsp.h>
+#include "MultichannelConvolution.h"
+
+// Linear-phase counterpart of the bass/mid/treble IIR section. The FIR is
+// synthesised from the magnitude response of the same shelf/peak filters on
+// a background thread and handed to a partitioned convolution per channel
+// pair, which swaps it into the audio path without locking. The cost is a
+// fixed latency of half the FIR length, the same on every channel.
+class LinearPhaseEQ : private juce::Thread
+{
+public:
+    LinearPhaseEQ();
+    ~LinearPhaseEQ() override;
+    
+    // The filter-design worker, for CPU pinning.
+    using juce::Thread::getThreadId;
+    
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void reset();
+    void process(const juce::dsp::ProcessContextReplacing<float>& context);
+    
+    // Callable from any thread; rebuilds are coalesced on the worker.
+    void setBands(float bassDb, float midDb, float trebleDb);
+    
+    int getLatencySamples() const { return latencySamples.load(); }
+    
+private:
+    void run() override;
+    void buildFilter();
+    
+    MultichannelConvolution convolution;
+    
+    std::atomic<float> bassGainDb { 0.0f };
+    std::atomic<float> midGainDb { 0.0f };
+    std::atomic<float> trebleGainDb { 0.0f };
+    std::atomic<double> sampleRate { 44100.0 };
+    std::atomic<int> firOrder { 12 };
+    std::atomic<int> latencySamples { 2048 };
+    std::atomic<bool> needsRebuild { false };
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LinearPhaseEQ)
+};
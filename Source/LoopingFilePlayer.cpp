@@ -0,0 +1,119 @@
+#include "LoopingFilePlayer.h"
+
+LoopingFilePlayer::LoopingFilePlayer(juce::TimeSliceThread& readThread) : thread(readThread)
+{
+    thread.addTimeSliceClient(this);
+}
+
+LoopingFilePlayer::~LoopingFilePlayer()
+{
+    // Waits for a slice in progress.
+    thread.removeTimeSliceClient(this);
+}
+
+void LoopingFilePlayer::prepare(double newSampleRate, int maxBlockSize)
+{
+    const juce::ScopedLock sl(lock);
+    sampleRate = newSampleRate;
+    
+    const int size = juce::jmax(maxBlockSize * 2, (int)(fifoSeconds * sampleRate)) + 1;
+    fifoBuffer.setSize(numChannels, size);
+    fifo.setTotalSize(size);
+    fifo.reset();
+    flushAcknowledged.store(flushGeneration.load());
+    
+    if (resampler != nullptr)
+    {
+        resampler->setResamplingRatio(source->getAudioFormatReader()->sampleRate / sampleRate);
+        resampler->prepareToPlay(maxReadSamples, sampleRate);
+    }
+}
+
+void LoopingFilePlayer::setReader(juce::AudioFormatReader* newReader)
+{
+    // Destroyed outside the lock, resampler first.
+    std::unique_ptr<juce::AudioFormatReaderSource> oldSource;
+    std::unique_ptr<juce::ResamplingAudioSource> oldResampler;
+    
+    const juce::ScopedLock sl(lock);
+    oldResampler = std::move(resampler);
+    oldSource = std::move(source);
+    
+    if (newReader != nullptr)
+    {
+        source = std::make_unique<juce::AudioFormatReaderSource>(newReader, true);
+        source->setLooping(true);
+        resampler = std::make_unique<juce::ResamplingAudioSource>(source.get(), false, numChannels);
+        resampler->setResamplingRatio(newReader->sampleRate / sampleRate);
+        resampler->prepareToPlay(maxReadSamples, sampleRate);
+    }
+    
+    flush();
+}
+
+void LoopingFilePlayer::setPosition(double seconds)
+{
+    const juce::ScopedLock sl(lock);
+    if (source == nullptr)
+        return;
+    
+    source->setNextReadPosition((juce::int64)(seconds * source->getAudioFormatReader()->sampleRate));
+    resampler->flushBuffers();
+    flush();
+}
+
+int LoopingFilePlayer::useTimeSlice()
+{
+    const juce::ScopedLock sl(lock);
+    
+    // Audio from before a load or seek is still queued until the audio
+    // thread has dropped it.
+    if (resampler == nullptr || flushAcknowledged.load(std::memory_order_acquire) != flushGeneration.load())
+        return 10;
+    
+    const int freeSpace = fifo.getFreeSpace();
+    if (freeSpace == 0)
+        return 10;
+    
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(juce::jmin(freeSpace, maxReadSamples), start1, size1, start2, size2);
+    if (size1 > 0)
+        resampler->getNextAudioBlock(juce::AudioSourceChannelInfo(&fifoBuffer, start1, size1));
+    if (size2 > 0)
+        resampler->getNextAudioBlock(juce::AudioSourceChannelInfo(&fifoBuffer, start2, size2));
+    fifo.finishedWrite(size1 + size2);
+    
+    return freeSpace > maxReadSamples ? 0 : 5;
+}
+
+void LoopingFilePlayer::read(float* const* dest, int numSamples) noexcept
+{
+    const int generation = flushGeneration.load(std::memory_order_acquire);
+    if (generation != flushAcknowledged.load(std::memory_order_relaxed))
+    {
+        fifo.finishedRead(fifo.getNumReady());
+        flushAcknowledged.store(generation, std::memory_order_release);
+    }
+    
+    int copied = 0;
+    if (playing.load())
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(numSamples, start1, size1, start2, size2);
+        
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            if (size1 > 0)
+                juce::FloatVectorOperations::copy(dest[ch], fifoBuffer.getReadPointer(ch, start1), size1);
+            if (size2 > 0)
+                juce::FloatVectorOperations::copy(dest[ch] + size1, fifoBuffer.getReadPointer(ch, start2), size2);
+        }
+        
+        copied = size1 + size2;
+        fifo.finishedRead(copied);
+    }
+    
+    if (copied < numSamples)
+        for (int ch = 0; ch < numChannels; ++ch)
+            juce::FloatVectorOperations::clear(dest[ch] + copied, numSamples - copied);
+}
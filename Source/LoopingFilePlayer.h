@@ -0,0 +1,57 @@
+#pragma once
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <atomic>
+
+// Loops an audio file for the mixer without the audio thread ever taking a
+// lock. A TimeSliceThread reads and resamples the file into a lock-free
+// FIFO, and the audio thread only copies out of it. Play/stop is an atomic
+// flag. Loading a file or seeking bumps a flush generation: the audio
+// thread drops whatever the FIFO holds and acknowledges, and only then does
+// the read thread write audio from the new position.
+class LoopingFilePlayer : private juce::TimeSliceClient
+{
+public:
+    static constexpr int numChannels = 2;
+    
+    explicit LoopingFilePlayer(juce::TimeSliceThread& readThread);
+    ~LoopingFilePlayer() override;
+    
+    // Not on the audio thread, and not while it is in read().
+    void prepare(double sampleRate, int maxBlockSize);
+    
+    // Message thread. Takes ownership of the reader; nullptr unloads.
+    void setReader(juce::AudioFormatReader* newReader);
+    void setPosition(double seconds);
+    void start() { playing.store(true); }
+    void stop() { playing.store(false); }
+    bool isPlaying() const { return playing.load(); }
+    
+    // Audio thread: fills both channels, with silence for whatever the read
+    // thread hasn't caught up with yet.
+    void read(float* const* dest, int numSamples) noexcept;
+    
+private:
+    int useTimeSlice() override;
+    void flush() { flushGeneration.fetch_add(1, std::memory_order_release); }
+    
+    static constexpr double fifoSeconds = 0.5;
+    static constexpr int maxReadSamples = 4096;
+    
+    juce::TimeSliceThread& thread;
+    
+    // Read thread, and the message/device threads under the lock.
+    juce::CriticalSection lock;
+    std::unique_ptr<juce::AudioFormatReaderSource> source;
+    std::unique_ptr<juce::ResamplingAudioSource> resampler;
+    double sampleRate = 48000.0;
+    
+    // Read thread -> audio thread.
+    juce::AbstractFifo fifo { 1 };
+    juce::AudioBuffer<float> fifoBuffer;
+    
+    std::atomic<bool> playing { false };
+    std::atomic<int> flushGeneration { 0 };
+    std::atomic<int> flushAcknowledged { 0 };   // written by the audio thread
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoopingFilePlayer)
+};
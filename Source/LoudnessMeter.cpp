@@ -0,0 +1,182 @@
+#include "LoudnessMeter.h"
+#include <cmath>
+
+void LoudnessMeter::prepare(double sampleRate, int numChannels)
+{
+    numChannelsPrepared = juce::jlimit(0, maxChannels, numChannels);
+    samplesPerStep = juce::jmax(1, juce::roundToInt(sampleRate * 0.1));
+    
+    // Pre-filter (high shelf) and RLB high-pass, derived for any sample rate
+    // from the analogue prototypes given in BS.1770.
+    {
+        const double f0 = 1681.974450955533;
+        const double gainDb = 3.999843853973347;
+        const double q = 0.7071752369554196;
+        
+        const double k = std::tan(juce::MathConstants<double>::pi * f0 / sampleRate);
+        const double vh = std::pow(10.0, gainDb / 20.0);
+        const double vb = std::pow(vh, 0.4996667741545416);
+        const double a0 = 1.0 + k / q + k * k;
+        
+        auto& s = stages[0];
+        s.b0 = (vh + vb * k / q + k * k) / a0;
+        s.b1 = 2.0 * (k * k - vh) / a0;
+        s.b2 = (vh - vb * k / q + k * k) / a0;
+        s.a1 = 2.0 * (k * k - 1.0) / a0;
+        s.a2 = (1.0 - k / q + k * k) / a0;
+    }
+    {
+        const double f0 = 38.13547087602444;
+        const double q = 0.5003270373238773;
+        
+        const double k = std::tan(juce::MathConstants<double>::pi * f0 / sampleRate);
+        const double a0 = 1.0 + k / q + k * k;
+        
+        auto& s = stages[1];
+        s.b0 = 1.0;
+        s.b1 = -2.0;
+        s.b2 = 1.0;
+        s.a1 = 2.0 * (k * k - 1.0) / a0;
+        s.a2 = (1.0 - k / q + k * k) / a0;
+    }
+    
+    reset();
+}
+
+void LoudnessMeter::reset()
+{
+    for (auto& state : channelStates)
+        state = {};
+    
+    samplesInStep = 0;
+    stepSum = 0.0;
+    stepEnergies.fill(0.0);
+    stepWritePos = 0;
+    stepsAvailable = 0;
+    histogramCounts.fill(0);
+    histogramEnergies.fill(0.0);
+    
+    momentaryLufs.store(silenceLufs);
+    shortTermLufs.store(silenceLufs);
+    integratedLufs.store(silenceLufs);
+}
+
+int LoudnessMeter::process(const juce::AudioBuffer<float>& buffer, int numSamples)
+{
+    const int numChannels = juce::jmin(numChannelsPrepared, buffer.getNumChannels());
+    int stepsCompleted = 0;
+    int pos = 0;
+    
+    while (pos < numSamples)
+    {
+        const int chunk = juce::jmin(numSamples - pos, samplesPerStep - samplesInStep);
+        
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const float* data = buffer.getReadPointer(ch, pos);
+            auto& state = channelStates[(size_t)ch];
+            double sum = 0.0;
+            
+            for (int i = 0; i < chunk; ++i)
+            {
+                double x = data[i];
+                
+                for (int s = 0; s < 2; ++s)
+                {
+                    const auto& c = stages[(size_t)s];
+                    const double y = c.b0 * x + state.z1[s];
+                    state.z1[s] = c.b1 * x - c.a1 * y + state.z2[s];
+                    state.z2[s] = c.b2 * x - c.a2 * y;
+                    x = y;
+                }
+                
+                sum += x * x;
+            }
+            
+            stepSum += sum;
+        }
+        
+        pos += chunk;
+        samplesInStep += chunk;
+        
+        if (samplesInStep == samplesPerStep)
+        {
+            completeStep();
+            ++stepsCompleted;
+        }
+    }
+    
+    return stepsCompleted;
+}
+
+void LoudnessMeter::completeStep()
+{
+    stepEnergies[(size_t)stepWritePos] = stepSum / (double)samplesPerStep;
+    stepWritePos = (stepWritePos + 1) % stepsPerShortTerm;
+    stepsAvailable = juce::jmin(stepsAvailable + 1, stepsPerShortTerm);
+    samplesInStep = 0;
+    stepSum = 0.0;
+    
+    auto windowEnergy = [this](int numSteps)
+    {
+        numSteps = juce::jmin(numSteps, stepsAvailable);
+        double sum = 0.0;
+        for (int i = 1; i <= numSteps; ++i)
+            sum += stepEnergies[(size_t)((stepWritePos - i + stepsPerShortTerm) % stepsPerShortTerm)];
+        return sum / (double)numSteps;
+    };
+    
+    const double momentaryEnergy = windowEnergy(stepsPerMomentary);
+    momentaryLufs.store(energyToLufs(momentaryEnergy));
+    shortTermLufs.store(energyToLufs(windowEnergy(stepsPerShortTerm)));
+    
+    // Every step closes one 400 ms gating block (75 % overlap).
+    if (stepsAvailable >= stepsPerMomentary)
+    {
+        const float blockLufs = energyToLufs(momentaryEnergy);
+        if (blockLufs > histogramFloorLufs)
+        {
+            const int bin = juce::jlimit(0, histogramBins - 1,
+                                         (int)((blockLufs - histogramFloorLufs) * 10.0f));
+            ++histogramCounts[(size_t)bin];
+            histogramEnergies[(size_t)bin] += momentaryEnergy;
+            updateIntegrated();
+        }
+    }
+}
+
+void LoudnessMeter::updateIntegrated()
+{
+    double absSum = 0.0;
+    juce::uint64 absCount = 0;
+    for (int bin = 0; bin < histogramBins; ++bin)
+    {
+        absSum += histogramEnergies[(size_t)bin];
+        absCount += histogramCounts[(size_t)bin];
+    }
+    
+    if (absCount == 0)
+        return;
+    
+    const float relativeGate = energyToLufs(absSum / (double)absCount) - 10.0f;
+    const int firstBin = juce::jlimit(0, histogramBins,
+                                      (int)std::ceil((relativeGate - histogramFloorLufs) * 10.0f));
+    
+    double gatedSum = 0.0;
+    juce::uint64 gatedCount = 0;
+    for (int bin = firstBin; bin < histogramBins; ++bin)
+    {
+        gatedSum += histogramEnergies[(size_t)bin];
+        gatedCount += histogramCounts[(size_t)bin];
+    }
+    
+    if (gatedCount > 0)
+        integratedLufs.store(energyToLufs(gatedSum / (double)gatedCount));
+}
+
+float LoudnessMeter::energyToLufs(double energy)
+{
+    if (energy <= 1.0e-10)
+        return silenceLufs;
+    return (float)(-0.691 + 10.0 * std::log10(energy));
+}
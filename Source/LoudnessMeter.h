@@ -0,0 +1,65 @@
+#pragma once
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+
+// ITU-R BS.1770 loudness meter. The K-weighting runs per sample, everything
+// else is evaluated once per 100 ms step: momentary (400 ms) and short-term
+// (3 s) windows come from a ring of step energies, and the integrated value
+// is gated against a fixed histogram of block loudness so it never has to
+// revisit old audio.
+class LoudnessMeter
+{
+public:
+    static constexpr int maxChannels = 8;
+    
+    void prepare(double sampleRate, int numChannels);
+    void reset();
+    
+    // Returns the number of 100 ms steps completed by this block.
+    int process(const juce::AudioBuffer<float>& buffer, int numSamples);
+    
+    float getMomentaryLoudness() const { return momentaryLufs.load(); }
+    float getShortTermLoudness() const { return shortTermLufs.load(); }
+    float getIntegratedLoudness() const { return integratedLufs.load(); }
+    
+    static constexpr float silenceLufs = -100.0f;
+    
+private:
+    struct Biquad
+    {
+        double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+    };
+    
+    struct ChannelState
+    {
+        double z1[2] = {}, z2[2] = {};
+    };
+    
+    void completeStep();
+    void updateIntegrated();
+    static float energyToLufs(double energy);
+    
+    static constexpr int stepsPerShortTerm = 30;
+    static constexpr int stepsPerMomentary = 4;
+    static constexpr int histogramBins = 750;    // 0.1 LU bins from -70 to +5 LUFS
+    static constexpr float histogramFloorLufs = -70.0f;
+    
+    std::array<Biquad, 2> stages;
+    std::array<ChannelState, maxChannels> channelStates;
+    int numChannelsPrepared = 0;
+    
+    int samplesPerStep = 4410;
+    int samplesInStep = 0;
+    double stepSum = 0.0;
+    
+    std::array<double, stepsPerShortTerm> stepEnergies {};
+    int stepWritePos = 0;
+    int stepsAvailable = 0;
+    
+    std::array<juce::uint32, histogramBins> histogramCounts {};
+    std::array<double, histogramBins> histogramEnergies {};
+    
+    std::atomic<float> momentaryLufs { silenceLufs };
+    std::atomic<float> shortTermLufs { silenceLufs };
+    std::atomic<float> integratedLufs { silenceLufs };
+};
@@ -7,7 +7,7 @@
 
 MainComponent::MainComponent()
 {
-    setSize(540, 750);
+    setSize(540, 986);
     
     // Header
     titleLabel.setText("Mic Booster", juce::dontSendNotification);
@@ -38,17 +38,25 @@ MainComponent::MainComponent()
     updateButton.setColour(juce::TextButton::buttonColourId, successColor.withAlpha(0.2f));
     updateButton.setColour(juce::TextButton::textColourOffId, successColor);
     updateButton.onClick = [this] {
-        if (!isDownloading && updateDownloadUrl.isNotEmpty())
+        if (!isDownloading && pendingUpdate.downloadUrl.isNotEmpty())
         {
             isDownloading = true;
             updateButton.setButtonText("Downloading...");
             updateButton.setEnabled(false);
-            
-            std::thread([this]() {
-                updateChecker.downloadUpdate(updateDownloadUrl);
-            }).detach();
+            updateChecker.downloadUpdate(pendingUpdate);
         }
     };
+    updateChecker.onDownloadProgress = [this](juce::int64 done, juce::int64 total) {
+        updateButton.setButtonText(total > 0 ? juce::String(100 * done / total) + "%"
+                                             : juce::File::descriptionOfSizeInBytes(done));
+    };
+    updateChecker.onDownloadFailed = [this](const juce::String& error) {
+        // The partial file is kept, so a retry picks up where this stopped.
+        isDownloading = false;
+        updateLabel.setText(error, juce::dontSendNotification);
+        updateButton.setButtonText("Retry");
+        updateButton.setEnabled(true);
+    };
     addChildComponent(updateButton);
     
     // Input Device
@@ -99,16 +107,7 @@ MainComponent::MainComponent()
     boostSlider.onValueChange = [this] {
         auto val = boostSlider.getValue();
         audioEngine.setBoostGain(static_cast<float>(val));
-        juce::String sign = val >= 0.0 ? "+" : "";
-        boostValueLabel.setText(sign + juce::String(val, 1) + " dB", juce::dontSendNotification);
-        
-        if (val > 30.0)
-            boostValueLabel.setColour(juce::Label::textColourId, errorColor);
-        else if (val > 20.0)
-            boostValueLabel.setColour(juce::Label::textColourId, warningColor);
-        else
-            boostValueLabel.setColour(juce::Label::textColourId, accentColor);
-        
+        updateBoostValueLabel(val);
         saveSettings();
     };
     addAndMakeVisible(boostSlider);
@@ -119,12 +118,40 @@ MainComponent::MainComponent()
     boostValueLabel.setColour(juce::Label::textColourId, accentColor);
     addAndMakeVisible(boostValueLabel);
     
+    autoGainToggle.setButtonText("Auto");
+    autoGainToggle.setColour(juce::ToggleButton::textColourId, textSecondary);
+    autoGainToggle.setColour(juce::ToggleButton::tickColourId, accentColor);
+    autoGainToggle.onClick = [this] {
+        bool enabled = autoGainToggle.getToggleState();
+        audioEngine.setAutoGainEnabled(enabled);
+        boostSlider.setEnabled(!enabled);
+        if (!enabled)
+            updateBoostValueLabel(boostSlider.getValue());
+        saveSettings();
+    };
+    addAndMakeVisible(autoGainToggle);
+    
+    loudnessLabel.setText("-- LUFS", juce::dontSendNotification);
+    loudnessLabel.setFont(juce::Font(10.0f));
+    loudnessLabel.setJustificationType(juce::Justification::centredRight);
+    loudnessLabel.setColour(juce::Label::textColourId, textSecondary);
+    addAndMakeVisible(loudnessLabel);
+    
     // EQ Section
     eqLabel.setText("TONE ADJUSTMENTS", juce::dontSendNotification);
     eqLabel.setFont(juce::Font(10.0f, juce::Font::bold));
     eqLabel.setColour(juce::Label::textColourId, textSecondary);
     addAndMakeVisible(eqLabel);
     
+    linearPhaseToggle.setButtonText("Linear phase");
+    linearPhaseToggle.setColour(juce::ToggleButton::textColourId, textSecondary);
+    linearPhaseToggle.setColour(juce::ToggleButton::tickColourId, accentColor);
+    linearPhaseToggle.onClick = [this] {
+        audioEngine.setLinearPhaseEQ(linearPhaseToggle.getToggleState());
+        saveSettings();
+    };
+    addAndMakeVisible(linearPhaseToggle);
+    
     // Bass
     bassLabel.setText("Bass", juce::dontSendNotification);
     bassLabel.setFont(juce::Font(11.0f, juce::Font::bold));
@@ -141,8 +168,7 @@ MainComponent::MainComponent()
     bassSlider.onValueChange = [this] {
         auto val = bassSlider.getValue();
         audioEngine.setBassGain(static_cast<float>(val));
-        juce::String sign = val >= 0.0 ? "+" : "";
-        bassValueLabel.setText(sign + juce::String(val, 1) + " dB", juce::dontSendNotification);
+        updateEQValueLabel(bassValueLabel, val);
         saveSettings();
     };
     addAndMakeVisible(bassSlider);
@@ -169,8 +195,7 @@ MainComponent::MainComponent()
     midSlider.onValueChange = [this] {
         auto val = midSlider.getValue();
         audioEngine.setMidGain(static_cast<float>(val));
-        juce::String sign = val >= 0.0 ? "+" : "";
-        midValueLabel.setText(sign + juce::String(val, 1) + " dB", juce::dontSendNotification);
+        updateEQValueLabel(midValueLabel, val);
         saveSettings();
     };
     addAndMakeVisible(midSlider);
@@ -197,8 +222,7 @@ MainComponent::MainComponent()
     trebleSlider.onValueChange = [this] {
         auto val = trebleSlider.getValue();
         audioEngine.setTrebleGain(static_cast<float>(val));
-        juce::String sign = val >= 0.0 ? "+" : "";
-        trebleValueLabel.setText(sign + juce::String(val, 1) + " dB", juce::dontSendNotification);
+        updateEQValueLabel(trebleValueLabel, val);
         saveSettings();
     };
     addAndMakeVisible(trebleSlider);
@@ -227,8 +251,10 @@ MainComponent::MainComponent()
     removePluginButton.setColour(juce::TextButton::textColourOffId, textSecondary);
     removePluginButton.onClick = [this] {
         audioEngine.removePlugin();
+        pluginRestorePending = false;
         pluginStatusLabel.setText("No plugin loaded", juce::dontSendNotification);
         pluginStatusLabel.setColour(juce::Label::textColourId, textSecondary);
+        savePluginSession();
     };
     addAndMakeVisible(removePluginButton);
     
@@ -237,6 +263,183 @@ MainComponent::MainComponent()
     pluginStatusLabel.setColour(juce::Label::textColourId, textSecondary);
     addAndMakeVisible(pluginStatusLabel);
     
+    // Noise suppression
+    noiseLabel.setText("NOISE SUPPRESSION", juce::dontSendNotification);
+    noiseLabel.setFont(juce::Font(10.0f, juce::Font::bold));
+    noiseLabel.setColour(juce::Label::textColourId, textSecondary);
+    addAndMakeVisible(noiseLabel);
+    
+    noiseToggle.setButtonText("Enabled");
+    noiseToggle.setColour(juce::ToggleButton::textColourId, textSecondary);
+    noiseToggle.setColour(juce::ToggleButton::tickColourId, accentColor);
+    noiseToggle.onClick = [this] {
+        audioEngine.setNoiseSuppressionEnabled(noiseToggle.getToggleState());
+        updateNoiseStatus();
+        saveSettings();
+    };
+    addAndMakeVisible(noiseToggle);
+    
+    learnNoiseButton.setButtonText("Learn Noise");
+    learnNoiseButton.setColour(juce::TextButton::buttonColourId, accentColor.withAlpha(0.15f));
+    learnNoiseButton.setColour(juce::TextButton::buttonOnColourId, accentColor.withAlpha(0.3f));
+    learnNoiseButton.setColour(juce::TextButton::textColourOffId, accentColor);
+    learnNoiseButton.onClick = [this] {
+        audioEngine.setNoiseLearning(!audioEngine.isNoiseLearning());
+        updateNoiseStatus();
+        saveSettings();
+    };
+    addAndMakeVisible(learnNoiseButton);
+    
+    adaptiveNoiseButton.setButtonText("Adaptive");
+    adaptiveNoiseButton.setColour(juce::TextButton::buttonColourId, surfaceColor);
+    adaptiveNoiseButton.setColour(juce::TextButton::textColourOffId, textSecondary);
+    adaptiveNoiseButton.onClick = [this] {
+        audioEngine.setNoiseLearning(false);
+        audioEngine.setNoiseSuppressionMode(NoiseSuppressor::Mode::adaptive);
+        updateNoiseStatus();
+        saveSettings();
+    };
+    addAndMakeVisible(adaptiveNoiseButton);
+    
+    noiseStatusLabel.setFont(juce::Font(11.0f));
+    noiseStatusLabel.setJustificationType(juce::Justification::centredRight);
+    addAndMakeVisible(noiseStatusLabel);
+    updateNoiseStatus();
+    
+    // Impulse response
+    irLabel.setText("IMPULSE RESPONSE", juce::dontSendNotification);
+    irLabel.setFont(juce::Font(10.0f, juce::Font::bold));
+    irLabel.setColour(juce::Label::textColourId, textSecondary);
+    addAndMakeVisible(irLabel);
+    
+    loadIRButton.setButtonText("Load IR");
+    loadIRButton.setColour(juce::TextButton::buttonColourId, accentColor.withAlpha(0.15f));
+    loadIRButton.setColour(juce::TextButton::buttonOnColourId, accentColor.withAlpha(0.3f));
+    loadIRButton.setColour(juce::TextButton::textColourOffId, accentColor);
+    loadIRButton.onClick = [this] { loadImpulseResponseClicked(); };
+    addAndMakeVisible(loadIRButton);
+    
+    clearIRButton.setButtonText("Clear");
+    clearIRButton.setColour(juce::TextButton::buttonColourId, surfaceColor);
+    clearIRButton.setColour(juce::TextButton::textColourOffId, textSecondary);
+    clearIRButton.onClick = [this] {
+        audioEngine.clearImpulseResponse();
+        updateImpulseResponseStatus();
+        saveSettings();
+    };
+    addAndMakeVisible(clearIRButton);
+    
+    irStatusLabel.setFont(juce::Font(11.0f));
+    irStatusLabel.setJustificationType(juce::Justification::centredRight);
+    addAndMakeVisible(irStatusLabel);
+    updateImpulseResponseStatus();
+    
+    // Background music
+    musicLabel.setText("BACKGROUND MUSIC", juce::dontSendNotification);
+    musicLabel.setFont(juce::Font(10.0f, juce::Font::bold));
+    musicLabel.setColour(juce::Label::textColourId, textSecondary);
+    addAndMakeVisible(musicLabel);
+    
+    musicDuckToggle.setButtonText("Duck");
+    musicDuckToggle.setToggleState(true, juce::dontSendNotification);
+    musicDuckToggle.setColour(juce::ToggleButton::textColourId, textSecondary);
+    musicDuckToggle.setColour(juce::ToggleButton::tickColourId, accentColor);
+    musicDuckToggle.onClick = [this] {
+        audioEngine.getMixer().setSourceDucked(musicSlot, musicDuckToggle.getToggleState());
+        saveSettings();
+    };
+    addAndMakeVisible(musicDuckToggle);
+    
+    loadMusicButton.setButtonText("Load Music");
+    loadMusicButton.setColour(juce::TextButton::buttonColourId, accentColor.withAlpha(0.15f));
+    loadMusicButton.setColour(juce::TextButton::buttonOnColourId, accentColor.withAlpha(0.3f));
+    loadMusicButton.setColour(juce::TextButton::textColourOffId, accentColor);
+    loadMusicButton.onClick = [this] { loadMusicClicked(); };
+    addAndMakeVisible(loadMusicButton);
+    
+    clearMusicButton.setButtonText("Clear");
+    clearMusicButton.setColour(juce::TextButton::buttonColourId, surfaceColor);
+    clearMusicButton.setColour(juce::TextButton::textColourOffId, textSecondary);
+    clearMusicButton.onClick = [this] {
+        audioEngine.getMixer().clearSource(musicSlot);
+        updateMusicStatus();
+        saveSettings();
+    };
+    addAndMakeVisible(clearMusicButton);
+    
+    musicGainSlider.setRange(-40.0, 6.0, 0.1);
+    musicGainSlider.setValue(-12.0, juce::dontSendNotification);
+    musicGainSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    musicGainSlider.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
+    musicGainSlider.setColour(juce::Slider::trackColourId, accentAlt);
+    musicGainSlider.setColour(juce::Slider::backgroundColourId, surfaceColor);
+    musicGainSlider.setColour(juce::Slider::thumbColourId, juce::Colours::white);
+    musicGainSlider.onValueChange = [this] {
+        audioEngine.getMixer().setSourceGain(musicSlot, (float)musicGainSlider.getValue());
+        updateMusicStatus();
+        saveSettings();
+    };
+    addAndMakeVisible(musicGainSlider);
+    audioEngine.getMixer().setSourceGain(musicSlot, (float)musicGainSlider.getValue());
+    
+    musicStatusLabel.setFont(juce::Font(11.0f));
+    musicStatusLabel.setJustificationType(juce::Justification::centredRight);
+    addAndMakeVisible(musicStatusLabel);
+    updateMusicStatus();
+    
+    // Presets
+    presetLabel.setText("PRESETS", juce::dontSendNotification);
+    presetLabel.setFont(juce::Font(10.0f, juce::Font::bold));
+    presetLabel.setColour(juce::Label::textColourId, textSecondary);
+    addAndMakeVisible(presetLabel);
+    
+    presetCombo.setTextWhenNothingSelected("No preset");
+    presetCombo.setColour(juce::ComboBox::backgroundColourId, surfaceColor);
+    presetCombo.setColour(juce::ComboBox::outlineColourId, cardBorderColor);
+    presetCombo.setColour(juce::ComboBox::textColourId, textPrimary);
+    presetCombo.setColour(juce::ComboBox::arrowColourId, accentColor);
+    presetCombo.onChange = [this] { recallPreset(presetCombo.getText()); };
+    addAndMakeVisible(presetCombo);
+    
+    savePresetButton.setButtonText("Save");
+    savePresetButton.setColour(juce::TextButton::buttonColourId, accentColor.withAlpha(0.15f));
+    savePresetButton.setColour(juce::TextButton::buttonOnColourId, accentColor.withAlpha(0.3f));
+    savePresetButton.setColour(juce::TextButton::textColourOffId, accentColor);
+    savePresetButton.onClick = [this] { savePresetClicked(); };
+    addAndMakeVisible(savePresetButton);
+    
+    deletePresetButton.setButtonText("Delete");
+    deletePresetButton.setColour(juce::TextButton::buttonColourId, surfaceColor);
+    deletePresetButton.setColour(juce::TextButton::textColourOffId, textSecondary);
+    deletePresetButton.onClick = [this] {
+        presetBank.remove(presetCombo.getText());
+        refreshPresetCombo({});
+        saveSettings();
+    };
+    addAndMakeVisible(deletePresetButton);
+    
+    presetCrossfadeLabel.setText("Crossfade", juce::dontSendNotification);
+    presetCrossfadeLabel.setFont(juce::Font(11.0f));
+    presetCrossfadeLabel.setColour(juce::Label::textColourId, textSecondary);
+    presetCrossfadeLabel.setJustificationType(juce::Justification::centredRight);
+    addAndMakeVisible(presetCrossfadeLabel);
+    
+    presetCrossfadeSlider.setRange(0.0, 2000.0, 10.0);
+    presetCrossfadeSlider.setValue(presetBank.getCrossfadeMs(), juce::dontSendNotification);
+    presetCrossfadeSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    presetCrossfadeSlider.setTextBoxStyle(juce::Slider::TextBoxRight, false, 60, 16);
+    presetCrossfadeSlider.setTextValueSuffix(" ms");
+    presetCrossfadeSlider.setColour(juce::Slider::trackColourId, accentAlt);
+    presetCrossfadeSlider.setColour(juce::Slider::backgroundColourId, surfaceColor);
+    presetCrossfadeSlider.setColour(juce::Slider::thumbColourId, juce::Colours::white);
+    presetCrossfadeSlider.setColour(juce::Slider::textBoxTextColourId, textSecondary);
+    presetCrossfadeSlider.setColour(juce::Slider::textBoxOutlineColourId, juce::Colours::transparentBlack);
+    presetCrossfadeSlider.onValueChange = [this] {
+        presetBank.setCrossfadeMs(presetCrossfadeSlider.getValue());
+        saveSettings();
+    };
+    addAndMakeVisible(presetCrossfadeSlider);
+    
     // Startup Toggle
     startupToggle.setButtonText("Launch on system startup");
     startupToggle.setColour(juce::ToggleButton::textColourId, textSecondary);
@@ -247,29 +450,105 @@ MainComponent::MainComponent()
     };
     addAndMakeVisible(startupToggle);
     
-    // Initialize
-    audioEngine.initialize();
+    // Initialize. Nothing below blocks: settings go to the DSP right away,
+    // while the device opens once, straight onto the saved choice, and the
+    // plugin formats register on a background thread.
+    startupTrace.mark("controls built");
     
-    auto inputs = audioEngine.getAvailableInputDevices();
-    for (int i = 0; i < inputs.size(); ++i)
-        inputDeviceCombo.addItem(inputs[i], i + 1);
+    VirtualAudioIODeviceType::Options virtualDevice;
+    if (virtualDevice.parseCommandLine(juce::JUCEApplicationBase::getCommandLineParameters()))
+    {
+        // Timed runs quit on their own so CI can compare the recorded output,
+        // with exit code 1 if silent input ran slower than active input.
+        virtualDevice.onFinished = [](bool passed) {
+            juce::MessageManager::callAsync([passed] {
+                if (auto* app = juce::JUCEApplicationBase::getInstance())
+                    app->setApplicationReturnValue(passed ? 0 : 1);
+                juce::JUCEApplicationBase::quit();
+            });
+        };
+        audioEngine.useVirtualDevice(virtualDevice);
+    }
     
-    auto outputs = audioEngine.getAvailableOutputDevices();
-    for (int i = 0; i < outputs.size(); ++i)
-        outputDeviceCombo.addItem(outputs[i], i + 1);
+    RealtimeTuning::Options realtime;
+    if (realtime.parseCommandLine(juce::JUCEApplicationBase::getCommandLineParameters()))
+        audioEngine.setRealtimeOptions(realtime);
+    
+    // --mix-device-channels=3,2 mixes device inputs 3-4 (one-based) under
+    // the mic instead of feeding them to it, e.g. a loopback of a player.
+    juce::ArgumentList args("MicBooster", juce::JUCEApplicationBase::getCommandLineParameters());
+    auto mixChannels = juce::StringArray::fromTokens(args.getValueForOption("--mix-device-channels"), ",", "");
+    if (mixChannels.size() > 0 && mixChannels[0].getIntValue() > 0)
+    {
+        audioEngine.getMixer().setDeviceSource(DuckingMixer::deviceSlot, mixChannels[0].getIntValue() - 1,
+                                               mixChannels.size() > 1 ? mixChannels[1].getIntValue() : 2);
+        audioEngine.getMixer().setSourceGain(DuckingMixer::deviceSlot,
+                                             (float)args.getValueForOption("--mix-device-gain").getDoubleValue());
+    }
+    
+    // --net-send=host:port streams the processed mic as RTP and
+    // --net-receive=port mixes in a stream from elsewhere; both together
+    // make a loopback test.
+    RtpAudioSender::Options networkOutput;
+    if (networkOutput.parseCommandLine(juce::JUCEApplicationBase::getCommandLineParameters()))
+        audioEngine.setNetworkOutput(networkOutput);
+    if (args.getValueForOption("--net-receive").getIntValue() > 0)
+        audioEngine.setNetworkInput(args.getValueForOption("--net-receive").getIntValue());
+    
+    // --metrics publishes live metrics to shared memory (MicBoosterMetrics
+    // reads them); --metrics=<file> picks the file.
+    const auto metricsPath = args.getValueForOption("--metrics");
+    if (metricsPath.isNotEmpty())
+        audioEngine.setMetricsFile(juce::File::getCurrentWorkingDirectory().getChildFile(metricsPath));
+    else if (args.containsOption("--metrics"))
+        audioEngine.setMetricsFile(MetricsPublisher::getDefaultFile());
+    
+    if (juce::JUCEApplicationBase::getCommandLineParameters().contains("--no-governor"))
+        audioEngine.setOverloadGovernorEnabled(false);
     
     loadSettings();
+    startupTrace.mark("settings applied");
+    
+    juce::AudioDeviceManager::AudioDeviceSetup preferredSetup;
+    preferredSetup.inputDeviceName = savedInputDevice;
+    preferredSetup.outputDeviceName = savedOutputDevice;
+    preferredSetup.sampleRate = savedSampleRate;
+    preferredSetup.bufferSize = savedBufferSize;
+    audioEngine.initializeAsync(preferredSetup, [this] { engineReady(); });
+    
+    // The formats are registered by now, so the saved plugin is restored
+    // while the device opens; installPlugin() re-prepares it if the device
+    // comes up at another rate. VST3 still instantiates on this thread.
+    juce::MessageManager::callAsync([safeThis = juce::Component::SafePointer<MainComponent>(this)] {
+        if (safeThis == nullptr)
+            return;
+        if (auto props = safeThis->getPropertiesFile())
+            safeThis->restorePluginSession(*props);
+    });
+    
+    juce::MessageManager::callAsync([safeThis = juce::Component::SafePointer<MainComponent>(this)] {
+        if (safeThis != nullptr)
+            safeThis->startupTrace.mark("window shown");
+    });
+    
+    // Device lists arrive from the background scan, and again on hot-plug.
+    audioEngine.getDeviceRegistry().onDevicesChanged = [this] { refreshDeviceCombos(); };
+    if (audioEngine.getDeviceRegistry().hasScanned())
+        refreshDeviceCombos();
     
     // Check for updates
     updateChecker.onUpdateFound = [this](const UpdateChecker::UpdateInfo& info) {
         updateAvailable = true;
         updateVersion = info.version;
-        updateDownloadUrl = info.downloadUrl;
+        pendingUpdate = info;
         updateLabel.setText("Update v" + info.version + " available!", juce::dontSendNotification);
         updateLabel.setVisible(true);
         updateButton.setVisible(info.downloadUrl.isNotEmpty());
         resized();
     };
+    auto updateUrl = juce::SystemStats::getEnvironmentVariable("MICBOOSTER_UPDATE_URL", {});
+    if (updateUrl.isNotEmpty())
+        updateChecker.setApiUrl(updateUrl);
     updateChecker.checkForUpdates();
     
     startTimer(30);
@@ -279,6 +558,7 @@ MainComponent::~MainComponent()
 {
     stopTimer();
     saveSettings();
+    savePluginSession();
 }
 
 std::unique_ptr<juce::PropertiesFile> MainComponent::getPropertiesFile()
@@ -296,12 +576,39 @@ void MainComponent::saveSettings()
     auto props = getPropertiesFile();
     if (props == nullptr) return;
     
-    props->setValue("inputDevice", inputDeviceCombo.getText());
-    props->setValue("outputDevice", outputDeviceCombo.getText());
+    // Until the first device scan lands the combos are empty; keep whatever
+    // was saved rather than overwriting it. A virtual-device run mustn't
+    // clobber the real hardware choice either.
+    if (!audioEngine.isUsingVirtualDevice())
+    {
+        if (inputDeviceCombo.getSelectedId() != 0)
+            props->setValue("inputDevice", inputDeviceCombo.getText());
+        if (outputDeviceCombo.getSelectedId() != 0)
+            props->setValue("outputDevice", outputDeviceCombo.getText());
+        if (audioEngine.isInitialized() && audioEngine.getDeviceSampleRate() > 0.0)
+        {
+            props->setValue("deviceSampleRate", audioEngine.getDeviceSampleRate());
+            props->setValue("deviceBufferSize", audioEngine.getDeviceBufferSize());
+        }
+    }
     props->setValue("boostGain", boostSlider.getValue());
     props->setValue("bassGain", bassSlider.getValue());
     props->setValue("midGain", midSlider.getValue());
     props->setValue("trebleGain", trebleSlider.getValue());
+    props->setValue("autoGain", autoGainToggle.getToggleState());
+    props->setValue("linearPhaseEQ", linearPhaseToggle.getToggleState());
+    props->setValue("noiseSuppression", noiseToggle.getToggleState());
+    props->setValue("noiseReduction", audioEngine.getNoiseReduction());
+    props->setValue("clipper", audioEngine.isClipperEnabled());
+    props->setValue("internalBlockSize", audioEngine.getInternalBlockSize());
+    props->setValue("clipperOversampling", (int)audioEngine.getStageOversampling(AudioEngine::OversampledStage::clipper));
+    props->setValue("pluginOversampling", (int)audioEngine.getStageOversampling(AudioEngine::OversampledStage::plugin));
+    props->setValue("autoGainTarget", audioEngine.getAutoGainTarget());
+    props->setValue("impulseResponse", audioEngine.getImpulseResponseFile().getFullPathName());
+    props->setValue("musicFile", audioEngine.getMixer().getSourceFile(musicSlot).getFullPathName());
+    props->setValue("musicGain", musicGainSlider.getValue());
+    props->setValue("musicDucked", musicDuckToggle.getToggleState());
+    props->setValue("presets", presetBank.toXml().get());
     props->saveIfNeeded();
 }
 
@@ -310,40 +617,200 @@ void MainComponent::loadSettings()
     auto props = getPropertiesFile();
     bool hasSettings = (props != nullptr && props->containsKey("inputDevice"));
     
-    if (hasSettings)
+    // First, since restoring the controls below saves settings as it goes.
+    if (props != nullptr)
     {
-        auto savedInput = props->getValue("inputDevice");
-        for (int i = 0; i < inputDeviceCombo.getNumItems(); ++i)
-        {
-            if (inputDeviceCombo.getItemText(i) == savedInput)
-            {
-                inputDeviceCombo.setSelectedItemIndex(i, juce::sendNotification);
-                break;
-            }
-        }
-        
-        auto savedOutput = props->getValue("outputDevice");
-        for (int i = 0; i < outputDeviceCombo.getNumItems(); ++i)
+        if (auto presetsXml = props->getXmlValue("presets"))
         {
-            if (outputDeviceCombo.getItemText(i) == savedOutput)
-            {
-                outputDeviceCombo.setSelectedItemIndex(i, juce::sendNotification);
-                break;
-            }
+            presetBank.restoreFromXml(*presetsXml);
+            refreshPresetCombo({});
+            presetCrossfadeSlider.setValue(presetBank.getCrossfadeMs(), juce::dontSendNotification);
         }
+    }
+    
+    if (hasSettings)
+    {
+        savedInputDevice = props->getValue("inputDevice");
+        savedOutputDevice = props->getValue("outputDevice");
+        savedSampleRate = props->getDoubleValue("deviceSampleRate", 0.0);
+        savedBufferSize = props->getIntValue("deviceBufferSize", 0);
         
         boostSlider.setValue(props->getDoubleValue("boostGain", 0.0), juce::sendNotification);
         bassSlider.setValue(props->getDoubleValue("bassGain", 0.0), juce::sendNotification);
         midSlider.setValue(props->getDoubleValue("midGain", 0.0), juce::sendNotification);
         trebleSlider.setValue(props->getDoubleValue("trebleGain", 0.0), juce::sendNotification);
+        
+        audioEngine.setAutoGainTarget((float)props->getDoubleValue("autoGainTarget", -18.0));
+        autoGainToggle.setToggleState(props->getBoolValue("autoGain", false), juce::sendNotification);
+        linearPhaseToggle.setToggleState(props->getBoolValue("linearPhaseEQ", false), juce::sendNotification);
+        
+        audioEngine.setNoiseReduction((float)props->getDoubleValue("noiseReduction", 18.0));
+        noiseToggle.setToggleState(props->getBoolValue("noiseSuppression", false), juce::sendNotification);
+        
+        auto toFactor = [](int value) {
+            return (StageOversampler::Factor)juce::jlimit(0, 3, value);
+        };
+        audioEngine.setClipperEnabled(props->getBoolValue("clipper", false));
+        audioEngine.setStageOversampling(AudioEngine::OversampledStage::clipper,
+                                         toFactor(props->getIntValue("clipperOversampling", 2)));
+        audioEngine.setStageOversampling(AudioEngine::OversampledStage::plugin,
+                                         toFactor(props->getIntValue("pluginOversampling", 0)));
+        
+        audioEngine.setInternalBlockSize(props->getIntValue("internalBlockSize", 0));
+        
+        auto savedIR = props->getValue("impulseResponse");
+        if (savedIR.isNotEmpty())
+        {
+            audioEngine.loadImpulseResponse(juce::File(savedIR));
+            updateImpulseResponseStatus();
+        }
+        
+        // Read before the controls below save over it.
+        auto savedMusic = props->getValue("musicFile");
+        musicGainSlider.setValue(props->getDoubleValue("musicGain", -12.0), juce::sendNotification);
+        musicDuckToggle.setToggleState(props->getBoolValue("musicDucked", true), juce::sendNotification);
+        
+        if (savedMusic.isNotEmpty())
+        {
+            audioEngine.getMixer().setFileSource(musicSlot, juce::File(savedMusic));
+            updateMusicStatus();
+        }
+    }
+}
+
+void MainComponent::savePluginSession()
+{
+    // An instance still being restored hasn't replaced the saved one yet.
+    if (pluginRestorePending)
+        return;
+    
+    auto props = getPropertiesFile();
+    if (props == nullptr) return;
+    
+    if (auto description = audioEngine.getPluginDescriptionXml())
+    {
+        props->setValue("pluginDescription", description.get());
+        props->setValue("pluginState", audioEngine.getPluginState().toBase64Encoding());
     }
     else
     {
-        if (inputDeviceCombo.getNumItems() > 0)
-            inputDeviceCombo.setSelectedId(1, juce::sendNotification);
-        if (outputDeviceCombo.getNumItems() > 0)
-            outputDeviceCombo.setSelectedId(1, juce::sendNotification);
+        props->removeValue("pluginDescription");
+        props->removeValue("pluginState");
     }
+    props->saveIfNeeded();
+}
+
+void MainComponent::restorePluginSession(juce::PropertiesFile& props)
+{
+    auto descriptionXml = props.getXmlValue("pluginDescription");
+    juce::PluginDescription description;
+    if (descriptionXml == nullptr || !description.loadFromXml(*descriptionXml))
+        return;
+    
+    juce::MemoryBlock state;
+    state.fromBase64Encoding(props.getValue("pluginState"));
+    
+    pluginRestorePending = true;
+    startupTrace.mark("plugin restore started");
+    pluginStatusLabel.setText("Restoring " + description.name + "...", juce::dontSendNotification);
+    pluginStatusLabel.setColour(juce::Label::textColourId, textSecondary);
+    
+    audioEngine.restorePlugin(description, state, [this, name = description.name](bool restored) {
+        // A plugin loaded by hand while this one was on its way wins.
+        if (!pluginRestorePending)
+            return;
+        pluginRestorePending = false;
+        
+        if (restored)
+        {
+            pluginStatusLabel.setText("Loaded: " + audioEngine.getPluginName(), juce::dontSendNotification);
+            pluginStatusLabel.setColour(juce::Label::textColourId, successColor);
+            startupTrace.mark("plugin restored");
+        }
+        else
+        {
+            pluginStatusLabel.setText("Couldn't restore " + name, juce::dontSendNotification);
+            pluginStatusLabel.setColour(juce::Label::textColourId, errorColor);
+        }
+    });
+}
+
+void MainComponent::engineReady()
+{
+    startupTrace.mark("audio device open");
+    engineStarted = true;
+    refreshDeviceCombos();
+}
+
+void MainComponent::refreshDeviceCombos()
+{
+    bool firstPopulation = inputDeviceCombo.getNumItems() == 0 && outputDeviceCombo.getNumItems() == 0;
+    
+    syncDeviceCombo(inputDeviceCombo, audioEngine.getAvailableInputDevices());
+    syncDeviceCombo(outputDeviceCombo, audioEngine.getAvailableOutputDevices());
+    
+    // The device is opened with the saved choice, so the combos only show
+    // it; selecting here must not reconfigure anything.
+    auto selectDevice = [](juce::ComboBox& combo, const juce::String& name) {
+        for (int i = 0; i < combo.getNumItems(); ++i)
+        {
+            if (combo.getItemText(i) == name)
+            {
+                combo.setSelectedItemIndex(i, juce::dontSendNotification);
+                return;
+            }
+        }
+    };
+    
+    if (audioEngine.isInitialized())
+    {
+        selectDevice(inputDeviceCombo, audioEngine.getCurrentInputDeviceName());
+        selectDevice(outputDeviceCombo, audioEngine.getCurrentOutputDeviceName());
+    }
+    else if (firstPopulation)
+    {
+        selectDevice(inputDeviceCombo, savedInputDevice);
+        selectDevice(outputDeviceCombo, savedOutputDevice);
+    }
+}
+
+void MainComponent::syncDeviceCombo(juce::ComboBox& combo, const juce::StringArray& devices)
+{
+    // ComboBox can't remove single items, so devices that went away are
+    // greyed out rather than dropped; that keeps item IDs and the current
+    // selection stable across hot-plug events.
+    for (int i = 0; i < combo.getNumItems(); ++i)
+        combo.setItemEnabled(combo.getItemId(i), devices.contains(combo.getItemText(i)));
+    
+    for (auto& name : devices)
+    {
+        bool known = false;
+        for (int i = 0; i < combo.getNumItems() && !known; ++i)
+            known = combo.getItemText(i) == name;
+        
+        if (!known)
+            combo.addItem(name, combo.getNumItems() + 1);
+    }
+}
+
+void MainComponent::updateEQValueLabel(juce::Label& label, double val)
+{
+    juce::String sign = val >= 0.0 ? "+" : "";
+    label.setText(sign + juce::String(val, 1) + " dB", juce::dontSendNotification);
+}
+
+void MainComponent::updateBoostValueLabel(double val)
+{
+    juce::String sign = val >= 0.0 ? "+" : "";
+    juce::String prefix = autoGainToggle.getToggleState() ? "AUTO " : "";
+    boostValueLabel.setText(prefix + sign + juce::String(val, 1) + " dB", juce::dontSendNotification);
+    
+    if (val > 30.0)
+        boostValueLabel.setColour(juce::Label::textColourId, errorColor);
+    else if (val > 20.0)
+        boostValueLabel.setColour(juce::Label::textColourId, warningColor);
+    else
+        boostValueLabel.setColour(juce::Label::textColourId, accentColor);
 }
 
 bool MainComponent::isStartupEnabled()
@@ -480,6 +947,14 @@ void MainComponent::paint(juce::Graphics& g)
     drawCard(g, area.removeFromTop(120));
     area.removeFromTop(8);
     drawCard(g, area.removeFromTop(98));
+    area.removeFromTop(8);
+    drawCard(g, area.removeFromTop(70));
+    area.removeFromTop(8);
+    drawCard(g, area.removeFromTop(70));
+    area.removeFromTop(8);
+    drawCard(g, area.removeFromTop(70));
+    area.removeFromTop(8);
+    drawCard(g, area.removeFromTop(70));
 }
 
 void MainComponent::resized()
@@ -519,9 +994,13 @@ void MainComponent::resized()
     // Boost card
     auto boostCard = area.removeFromTop(110);
     auto boostInner = boostCard.reduced(14, 10);
-    boostLabel.setBounds(boostInner.removeFromTop(16));
+    auto boostHeader = boostInner.removeFromTop(16);
+    autoGainToggle.setBounds(boostHeader.removeFromRight(64));
+    boostLabel.setBounds(boostHeader);
     boostInner.removeFromTop(2);
-    boostValueLabel.setBounds(boostInner.removeFromTop(30));
+    auto boostValueRow = boostInner.removeFromTop(30);
+    boostValueLabel.setBounds(boostValueRow);
+    loudnessLabel.setBounds(boostValueRow.removeFromRight(90));
     boostInner.removeFromTop(2);
     boostSlider.setBounds(boostInner.removeFromTop(24));
     area.removeFromTop(8);
@@ -529,7 +1008,9 @@ void MainComponent::resized()
     // EQ card
     auto eqCard = area.removeFromTop(120);
     auto eqInner = eqCard.reduced(14, 8);
-    eqLabel.setBounds(eqInner.removeFromTop(16));
+    auto eqHeader = eqInner.removeFromTop(16);
+    linearPhaseToggle.setBounds(eqHeader.removeFromRight(100));
+    eqLabel.setBounds(eqHeader);
     eqInner.removeFromTop(6);
     
     auto eqRow = [&](juce::Label& label, juce::Slider& slider, juce::Label& valueLabel) {
@@ -560,6 +1041,66 @@ void MainComponent::resized()
     pluginStatusLabel.setBounds(plugInner.removeFromTop(20));
     area.removeFromTop(8);
     
+    // Noise suppression card
+    auto noiseCard = area.removeFromTop(70);
+    auto noiseInner = noiseCard.reduced(14, 10);
+    auto noiseHeader = noiseInner.removeFromTop(16);
+    noiseToggle.setBounds(noiseHeader.removeFromRight(80));
+    noiseLabel.setBounds(noiseHeader);
+    noiseInner.removeFromTop(6);
+    auto noiseRow = noiseInner.removeFromTop(28);
+    learnNoiseButton.setBounds(noiseRow.removeFromLeft(110));
+    noiseRow.removeFromLeft(8);
+    adaptiveNoiseButton.setBounds(noiseRow.removeFromLeft(80));
+    noiseRow.removeFromLeft(8);
+    noiseStatusLabel.setBounds(noiseRow);
+    area.removeFromTop(8);
+    
+    // Impulse response card
+    auto irCard = area.removeFromTop(70);
+    auto irInner = irCard.reduced(14, 10);
+    irLabel.setBounds(irInner.removeFromTop(16));
+    irInner.removeFromTop(6);
+    auto irRow = irInner.removeFromTop(28);
+    loadIRButton.setBounds(irRow.removeFromLeft(110));
+    irRow.removeFromLeft(8);
+    clearIRButton.setBounds(irRow.removeFromLeft(80));
+    irRow.removeFromLeft(8);
+    irStatusLabel.setBounds(irRow);
+    area.removeFromTop(8);
+    
+    // Background music card
+    auto musicCard = area.removeFromTop(70);
+    auto musicInner = musicCard.reduced(14, 10);
+    auto musicHeader = musicInner.removeFromTop(16);
+    musicDuckToggle.setBounds(musicHeader.removeFromRight(80));
+    musicLabel.setBounds(musicHeader.removeFromLeft(140));
+    musicStatusLabel.setBounds(musicHeader);
+    musicInner.removeFromTop(6);
+    auto musicRow = musicInner.removeFromTop(28);
+    loadMusicButton.setBounds(musicRow.removeFromLeft(110));
+    musicRow.removeFromLeft(8);
+    clearMusicButton.setBounds(musicRow.removeFromLeft(80));
+    musicRow.removeFromLeft(8);
+    musicGainSlider.setBounds(musicRow);
+    area.removeFromTop(8);
+    
+    // Presets card
+    auto presetCard = area.removeFromTop(70);
+    auto presetInner = presetCard.reduced(14, 10);
+    auto presetHeader = presetInner.removeFromTop(16);
+    presetCrossfadeSlider.setBounds(presetHeader.removeFromRight(180));
+    presetCrossfadeLabel.setBounds(presetHeader.removeFromRight(70));
+    presetLabel.setBounds(presetHeader);
+    presetInner.removeFromTop(6);
+    auto presetRow = presetInner.removeFromTop(28);
+    deletePresetButton.setBounds(presetRow.removeFromRight(80));
+    presetRow.removeFromRight(8);
+    savePresetButton.setBounds(presetRow.removeFromRight(80));
+    presetRow.removeFromRight(8);
+    presetCombo.setBounds(presetRow);
+    area.removeFromTop(8);
+    
     startupToggle.setBounds(area.removeFromTop(24));
 }
 
@@ -571,6 +1112,22 @@ void MainComponent::timerCallback()
     smoothedInputLevel = smoothedInputLevel * 0.8f + targetIn * 0.2f;
     smoothedOutputLevel = smoothedOutputLevel * 0.8f + targetOut * 0.2f;
     
+    auto shortTerm = audioEngine.getShortTermLoudness();
+    if (shortTerm > LoudnessMeter::silenceLufs)
+        loudnessLabel.setText(juce::String(shortTerm, 1) + " LUFS", juce::dontSendNotification);
+    else
+        loudnessLabel.setText("-- LUFS", juce::dontSendNotification);
+    
+    if (audioEngine.isAutoGainEnabled())
+        updateBoostValueLabel(audioEngine.getAutoGainDb());
+    
+    if (!startupTrace.isFinished() && engineStarted && !pluginRestorePending
+        && audioEngine.getFirstAudioTimeMs() > 0.0)
+    {
+        startupTrace.mark("first audio callback", audioEngine.getFirstAudioTimeMs());
+        startupTrace.finish();
+    }
+    
     repaint();
 }
 
@@ -592,8 +1149,10 @@ void MainComponent::loadPluginClicked()
             
             if (audioEngine.hasPluginLoaded())
             {
+                pluginRestorePending = false;
                 pluginStatusLabel.setText("Loaded: " + audioEngine.getPluginName(), juce::dontSendNotification);
                 pluginStatusLabel.setColour(juce::Label::textColourId, successColor);
+                savePluginSession();
             }
             else
             {
@@ -603,3 +1162,160 @@ void MainComponent::loadPluginClicked()
         }
     });
 }
+
+
+void MainComponent::loadImpulseResponseClicked()
+{
+    auto chooser = std::make_shared<juce::FileChooser>(
+        "Select an impulse response",
+        juce::File::getSpecialLocation(juce::File::userDocumentsDirectory),
+        "*.wav;*.aif;*.aiff");
+    
+    auto flags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles;
+    
+    chooser->launchAsync(flags, [this, chooser](const juce::FileChooser&)
+    {
+        auto file = chooser->getResult();
+        if (file.existsAsFile())
+        {
+            audioEngine.loadImpulseResponse(file);
+            updateImpulseResponseStatus();
+            saveSettings();
+        }
+    });
+}
+
+void MainComponent::updateImpulseResponseStatus()
+{
+    if (audioEngine.hasImpulseResponseLoaded())
+    {
+        irStatusLabel.setText(audioEngine.getImpulseResponseFile().getFileName(), juce::dontSendNotification);
+        irStatusLabel.setColour(juce::Label::textColourId, successColor);
+    }
+    else
+    {
+        irStatusLabel.setText("No IR loaded", juce::dontSendNotification);
+        irStatusLabel.setColour(juce::Label::textColourId, textSecondary);
+    }
+}
+
+void MainComponent::loadMusicClicked()
+{
+    auto chooser = std::make_shared<juce::FileChooser>(
+        "Select background music",
+        juce::File::getSpecialLocation(juce::File::userMusicDirectory),
+        "*.wav;*.aif;*.aiff;*.flac;*.ogg;*.mp3");
+    
+    auto flags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles;
+    
+    chooser->launchAsync(flags, [this, chooser](const juce::FileChooser&)
+    {
+        auto file = chooser->getResult();
+        if (file.existsAsFile())
+        {
+            audioEngine.getMixer().setFileSource(musicSlot, file);
+            updateMusicStatus();
+            saveSettings();
+        }
+    });
+}
+
+void MainComponent::updateMusicStatus()
+{
+    auto& mixer = audioEngine.getMixer();
+    if (mixer.getSourceType(musicSlot) == DuckingMixer::SourceType::file)
+    {
+        musicStatusLabel.setText(mixer.getSourceFile(musicSlot).getFileName() + "  "
+                                 + juce::String(musicGainSlider.getValue(), 1) + " dB", juce::dontSendNotification);
+        musicStatusLabel.setColour(juce::Label::textColourId, successColor);
+    }
+    else
+    {
+        musicStatusLabel.setText("No music loaded", juce::dontSendNotification);
+        musicStatusLabel.setColour(juce::Label::textColourId, textSecondary);
+    }
+}
+
+void MainComponent::updateNoiseStatus()
+{
+    bool learning = audioEngine.isNoiseLearning();
+    learnNoiseButton.setButtonText(learning ? "Stop Learning" : "Learn Noise");
+    
+    juce::String status;
+    if (learning)
+        status = "Learning...";
+    else if (audioEngine.getNoiseSuppressionMode() == NoiseSuppressor::Mode::learned)
+        status = "Learned profile";
+    else
+        status = "Adaptive profile";
+    
+    noiseStatusLabel.setText(status, juce::dontSendNotification);
+    noiseStatusLabel.setColour(juce::Label::textColourId,
+                               noiseToggle.getToggleState() ? successColor : textSecondary);
+}
+
+void MainComponent::savePresetClicked()
+{
+    auto* window = new juce::AlertWindow("Save Preset", "Name this preset:",
+                                         juce::MessageBoxIconType::NoIcon, this);
+    window->addTextEditor("name", presetCombo.getText());
+    window->addButton("Save", 1, juce::KeyPress(juce::KeyPress::returnKey));
+    window->addButton("Cancel", 0, juce::KeyPress(juce::KeyPress::escapeKey));
+    
+    window->enterModalState(true, juce::ModalCallbackFunction::create([this, window](int result)
+    {
+        auto name = window->getTextEditorContents("name").trim();
+        if (result != 1 || name.isEmpty())
+            return;
+        
+        // Captures the plugin state now, so recalling it later is instant.
+        presetBank.store(name, audioEngine.getSnapshot());
+        refreshPresetCombo(name);
+        saveSettings();
+    }), true);
+}
+
+void MainComponent::recallPreset(const juce::String& name)
+{
+    auto* preset = presetBank.find(name);
+    if (preset == nullptr)
+        return;
+    
+    audioEngine.recallSnapshot(preset->snapshot, presetBank.getCrossfadeMs());
+    syncControlsFromEngine();
+    saveSettings();
+}
+
+void MainComponent::refreshPresetCombo(const juce::String& selectedName)
+{
+    presetCombo.clear(juce::dontSendNotification);
+    auto names = presetBank.getNames();
+    
+    for (int i = 0; i < names.size(); ++i)
+    {
+        presetCombo.addItem(names[i], i + 1);
+        if (names[i] == selectedName)
+            presetCombo.setSelectedId(i + 1, juce::dontSendNotification);
+    }
+}
+
+void MainComponent::syncControlsFromEngine()
+{
+    // The engine already has the values (and is morphing towards them), so
+    // only the controls and labels are updated here.
+    boostSlider.setValue(audioEngine.getCurrentBoostGain(), juce::dontSendNotification);
+    bassSlider.setValue(audioEngine.getBassGain(), juce::dontSendNotification);
+    midSlider.setValue(audioEngine.getMidGain(), juce::dontSendNotification);
+    trebleSlider.setValue(audioEngine.getTrebleGain(), juce::dontSendNotification);
+    updateEQValueLabel(bassValueLabel, bassSlider.getValue());
+    updateEQValueLabel(midValueLabel, midSlider.getValue());
+    updateEQValueLabel(trebleValueLabel, trebleSlider.getValue());
+    
+    autoGainToggle.setToggleState(audioEngine.isAutoGainEnabled(), juce::dontSendNotification);
+    boostSlider.setEnabled(!autoGainToggle.getToggleState());
+    updateBoostValueLabel(boostSlider.getValue());
+    
+    linearPhaseToggle.setToggleState(audioEngine.isLinearPhaseEQ(), juce::dontSendNotification);
+    noiseToggle.setToggleState(audioEngine.isNoiseSuppressionEnabled(), juce::dontSendNotification);
+    updateNoiseStatus();
+}
@@ -1,6 +1,8 @@
 #pragma once
 #include <juce_gui_extra/juce_gui_extra.h>
 #include "AudioEngine.h"
+#include "PresetBank.h"
+#include "StartupTrace.h"
 #include "UpdateChecker.h"
 
 class MainComponent : public juce::Component,
@@ -16,16 +18,35 @@ public:
 private:
     void timerCallback() override;
     void loadPluginClicked();
+    void loadImpulseResponseClicked();
+    void updateImpulseResponseStatus();
+    void loadMusicClicked();
+    void updateMusicStatus();
+    void updateNoiseStatus();
+    void savePresetClicked();
+    void recallPreset(const juce::String& name);
+    void refreshPresetCombo(const juce::String& selectedName);
+    void syncControlsFromEngine();
     void drawCard(juce::Graphics& g, juce::Rectangle<int> bounds, float cornerRadius = 12.0f);
     void drawMeter(juce::Graphics& g, juce::Rectangle<int> bounds, float level, juce::Colour color);
     
     void saveSettings();
     void loadSettings();
+    void savePluginSession();
+    void restorePluginSession(juce::PropertiesFile& props);
+    void refreshDeviceCombos();
+    void syncDeviceCombo(juce::ComboBox& combo, const juce::StringArray& devices);
     std::unique_ptr<juce::PropertiesFile> getPropertiesFile();
     
     bool isStartupEnabled();
     void setStartupEnabled(bool enabled);
+    void updateBoostValueLabel(double val);
+    void updateEQValueLabel(juce::Label& label, double val);
     
+    void engineReady();
+    
+    StartupTrace startupTrace;      // first, so it times everything below
+    bool engineStarted = false;
     AudioEngine audioEngine;
     UpdateChecker updateChecker;
     
@@ -37,7 +58,7 @@ private:
     // Update banner
     bool updateAvailable = false;
     juce::String updateVersion;
-    juce::String updateDownloadUrl;
+    UpdateChecker::UpdateInfo pendingUpdate;
     juce::TextButton updateButton;
     juce::Label updateLabel;
     bool isDownloading = false;
@@ -45,14 +66,20 @@ private:
     // Device selection
     juce::Label inputLabel, outputLabel;
     juce::ComboBox inputDeviceCombo, outputDeviceCombo;
+    juce::String savedInputDevice, savedOutputDevice;
+    double savedSampleRate = 0.0;   // 0 = device default
+    int savedBufferSize = 0;
     
     // Boost
     juce::Slider boostSlider;
     juce::Label boostLabel;
     juce::Label boostValueLabel;
+    juce::ToggleButton autoGainToggle;
+    juce::Label loudnessLabel;
     
     // EQ controls
     juce::Label eqLabel;
+    juce::ToggleButton linearPhaseToggle;
     juce::Slider bassSlider, midSlider, trebleSlider;
     juce::Label bassLabel, midLabel, trebleLabel;
     juce::Label bassValueLabel, midValueLabel, trebleValueLabel;
@@ -62,6 +89,38 @@ private:
     juce::TextButton removePluginButton;
     juce::Label pluginLabel;
     juce::Label pluginStatusLabel;
+    bool pluginRestorePending = false;
+    
+    // Noise suppression
+    juce::Label noiseLabel;
+    juce::ToggleButton noiseToggle;
+    juce::TextButton learnNoiseButton;
+    juce::TextButton adaptiveNoiseButton;
+    juce::Label noiseStatusLabel;
+    
+    // Impulse response
+    juce::Label irLabel;
+    juce::TextButton loadIRButton;
+    juce::TextButton clearIRButton;
+    juce::Label irStatusLabel;
+    
+    // Background music
+    static constexpr int musicSlot = DuckingMixer::musicSlot;
+    juce::Label musicLabel;
+    juce::ToggleButton musicDuckToggle;
+    juce::TextButton loadMusicButton;
+    juce::TextButton clearMusicButton;
+    juce::Slider musicGainSlider;
+    juce::Label musicStatusLabel;
+    
+    // Presets
+    PresetBank presetBank;
+    juce::Label presetLabel;
+    juce::ComboBox presetCombo;
+    juce::TextButton savePresetButton;
+    juce::TextButton deletePresetButton;
+    juce::Label presetCrossfadeLabel;
+    juce::Slider presetCrossfadeSlider;
     
     // Settings
     juce::ToggleButton startupToggle;
@@ -0,0 +1,68 @@
+#include "MetricsPublisher.h"
+#include <new>
+
+bool MetricsPublisher::open(const juce::File& file)
+{
+    close();
+    
+    juce::MemoryBlock zeros(sizeof(SharedMetrics::Segment), true);
+    if (!file.getParentDirectory().createDirectory() || !file.replaceWithData(zeros.getData(), zeros.getSize()))
+    {
+        juce::Logger::writeToLog("[metrics] can't create " + file.getFullPathName());
+        return false;
+    }
+    
+    auto mapping = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readWrite);
+    if (mapping->getData() == nullptr || mapping->getSize() < sizeof(SharedMetrics::Segment))
+    {
+        juce::Logger::writeToLog("[metrics] can't map " + file.getFullPathName());
+        return false;
+    }
+    
+    // The magic goes in last, so a reader never takes a half-set-up segment.
+    auto* newSegment = new (mapping->getData()) SharedMetrics::Segment();
+    newSegment->version = SharedMetrics::version;
+    newSegment->size = (juce::uint32)sizeof(SharedMetrics::Segment);
+    newSegment->sequence.store(0);
+    std::atomic_thread_fence(std::memory_order_release);
+    newSegment->magic = SharedMetrics::magic;
+    
+    mappedFile = std::move(mapping);
+    segment = newSegment;
+    callbacks = 0;
+    samplesProcessed = 0;
+    peakLoad = 0.0f;
+    overruns = 0;
+    
+    juce::Logger::writeToLog("[metrics] publishing to " + file.getFullPathName());
+    return true;
+}
+
+void MetricsPublisher::close()
+{
+    segment = nullptr;
+    mappedFile.reset();
+}
+
+void MetricsPublisher::publish(SharedMetrics::Values& values, int numSamples, double sampleRate,
+                               double elapsedSeconds) noexcept
+{
+    if (segment == nullptr || numSamples <= 0 || sampleRate <= 0.0)
+        return;
+    
+    const auto load = (float)(elapsedSeconds * sampleRate / numSamples);
+    peakLoad = juce::jmax(peakLoad, load);
+    if (load >= 1.0f)
+        ++overruns;
+    
+    values.callbacks = ++callbacks;
+    values.samplesProcessed = samplesProcessed += (juce::uint64)numSamples;
+    values.sampleRate = sampleRate;
+    values.blockSize = numSamples;
+    values.callbackMs = (float)(elapsedSeconds * 1000.0);
+    values.callbackLoad = load;
+    values.peakCallbackLoad = peakLoad;
+    values.overruns = overruns;
+    
+    SharedMetrics::write(*segment, values);
+}
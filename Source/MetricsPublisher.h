@@ -0,0 +1,47 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <memory>
+#include "SharedMetrics.h"
+
+// Publishes the engine's live metrics into a memory-mapped file laid out as
+// a SharedMetrics::Segment, for external dashboards and monitoring agents.
+// The audio thread writes once per callback with no locks or syscalls;
+// readers on the same machine map the file and poll it through the seqlock
+// in SharedMetrics.h (or run MicBoosterMetrics).
+//
+// The file is left behind on close; a stale one is recognised by its
+// callback count no longer moving.
+class MetricsPublisher
+{
+public:
+    MetricsPublisher() = default;
+    
+    // /dev/shm where there is one (never touches the disk), else the temp folder.
+    static juce::File getDefaultFile()
+    {
+        const juce::File shm("/dev/shm");
+        return (shm.isDirectory() ? shm : juce::File::getSpecialLocation(juce::File::tempDirectory))
+                   .getChildFile("MicBooster.metrics");
+    }
+    
+    // Not on the audio thread (the engine holds the callback lock).
+    bool open(const juce::File& file);
+    void close();
+    bool isOpen() const { return segment != nullptr; }
+    juce::File getFile() const { return mappedFile != nullptr ? mappedFile->getFile() : juce::File(); }
+    
+    // Audio thread: fills in the callback counters and timing, then writes.
+    void publish(SharedMetrics::Values& values, int numSamples, double sampleRate, double elapsedSeconds) noexcept;
+    
+private:
+    std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+    SharedMetrics::Segment* segment = nullptr;
+    
+    // Audio thread.
+    juce::uint64 callbacks = 0;
+    juce::uint64 samplesProcessed = 0;
+    float peakLoad = 0.0f;
+    juce::uint32 overruns = 0;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MetricsPublisher)
+};
@@ -0,0 +1,105 @@
+#include <juce_core/juce_core.h>
+#include <cmath>
+#include <iostream>
+#include "MetricsPublisher.h"
+
+// MicBoosterMetrics: prints the live metrics a running MicBooster --metrics
+// publishes, or measures how fast they can be sampled.
+//
+//   MicBoosterMetrics [--file=<path>] [--interval-ms=500] [--count=N] [--bench]
+namespace
+{
+    juce::String formatValues(const SharedMetrics::Values& v)
+    {
+        auto db = [](float gain) { return juce::String(gain > 1.0e-5f ? 20.0f * std::log10(gain) : -100.0f, 1); };
+        
+        return "in " + db(v.inputPeak) + " dBFS, out " + db(v.outputPeak) + " dBFS, "
+             + juce::String(v.shortTermLufs, 1) + " LUFS (" + juce::String(v.integratedLufs, 1) + " int), "
+             + "boost " + juce::String(v.boostDb, 1) + " dB, ducking " + juce::String(v.duckingDb, 1)
+             + " dB, clipper " + juce::String(v.clipperReductionDb, 1) + " dB | "
+             + juce::String(v.blockSize) + " @ " + juce::String(v.sampleRate, 0) + " Hz, "
+             + juce::String(v.callbackMs, 3) + " ms (load " + juce::String(v.callbackLoad, 2)
+             + ", peak " + juce::String(v.peakCallbackLoad, 2) + "), overruns " + juce::String(v.overruns)
+             + ", xruns " + juce::String(v.deviceXruns) + ", shed " + juce::String(v.shedStages)
+             + ", callbacks " + juce::String((juce::int64)v.callbacks);
+    }
+    
+    // Reads back to back for a second, to show what a dashboard can poll at.
+    void runBenchmark(const SharedMetrics::Segment& segment)
+    {
+        SharedMetrics::Values values;
+        juce::int64 reads = 0, failures = 0, distinct = 0;
+        std::uint64_t lastCallbacks = 0;
+        
+        const auto endTicks = juce::Time::getHighResolutionTicks() + juce::Time::secondsToHighResolutionTicks(1.0);
+        while (juce::Time::getHighResolutionTicks() < endTicks)
+        {
+            for (int i = 0; i < 1000; ++i, ++reads)
+            {
+                if (!SharedMetrics::read(segment, values, 1))
+                {
+                    ++failures;
+                    continue;
+                }
+                
+                if (values.callbacks != lastCallbacks)
+                {
+                    lastCallbacks = values.callbacks;
+                    ++distinct;
+                }
+            }
+        }
+        
+        std::cout << reads << " reads in 1 s (" << juce::String(1.0e9 / (double)reads, 1) << " ns each), "
+                  << failures << " raced the writer, " << distinct << " distinct callbacks seen" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ArgumentList args(argc, argv);
+    
+    const auto path = args.getValueForOption("--file");
+    const auto file = path.isNotEmpty() ? juce::File::getCurrentWorkingDirectory().getChildFile(path)
+                                        : MetricsPublisher::getDefaultFile();
+    
+    juce::MemoryMappedFile mapping(file, juce::MemoryMappedFile::readOnly);
+    if (mapping.getData() == nullptr || mapping.getSize() < sizeof(SharedMetrics::Segment))
+    {
+        std::cerr << "No metrics at " << file.getFullPathName() << " (is MicBooster running with --metrics?)" << std::endl;
+        return 1;
+    }
+    
+    const auto& segment = *static_cast<const SharedMetrics::Segment*>(mapping.getData());
+    SharedMetrics::Values values;
+    if (!SharedMetrics::read(segment, values))
+    {
+        std::cerr << file.getFullPathName() << " is not a MicBooster metrics file of this version" << std::endl;
+        return 1;
+    }
+    
+    if (args.containsOption("--bench"))
+    {
+        runBenchmark(segment);
+        return 0;
+    }
+    
+    const auto intervalArg = args.getValueForOption("--interval-ms");
+    const int intervalMs = intervalArg.isNotEmpty() ? juce::jmax(1, intervalArg.getIntValue()) : 500;
+    const int count = args.getValueForOption("--count").getIntValue();   // 0 = until interrupted
+    std::uint64_t lastCallbacks = values.callbacks;
+    
+    for (int i = 0; count <= 0 || i < count; ++i)
+    {
+        if (i > 0)
+            juce::Thread::sleep(intervalMs);
+        
+        if (!SharedMetrics::read(segment, values))
+            continue;
+        
+        const bool stale = i > 0 && values.callbacks == lastCallbacks;
+        lastCallbacks = values.callbacks;
+        std::cout << formatValues(values) << (stale ? " [stale]" : "") << std::endl;
+    }
+    return 0;
+}
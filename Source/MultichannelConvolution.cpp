@@ -0,0 +1,63 @@
+#include "MultichannelConvolution.h"
+
+MultichannelConvolution::MultichannelConvolution()
+{
+    for (auto& pair : pairs)
+        pair = std::make_unique<juce::dsp::Convolution>(loadQueue);
+}
+
+void MultichannelConvolution::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    numChannels = juce::jlimit(1, maxChannels, (int)spec.numChannels);
+    
+    // Every pair is prepared, used or not, so a wider device later doesn't
+    // have to wait for its IR to be loaded again.
+    for (int p = 0; p < maxPairs; ++p)
+    {
+        auto pairSpec = spec;
+        pairSpec.numChannels = (juce::uint32)juce::jlimit(1, 2, numChannels - 2 * p);
+        pairs[(size_t)p]->prepare(pairSpec);
+    }
+}
+
+void MultichannelConvolution::reset()
+{
+    for (auto& pair : pairs)
+        pair->reset();
+}
+
+void MultichannelConvolution::process(const juce::dsp::ProcessContextReplacing<float>& context)
+{
+    auto block = context.getOutputBlock();
+    const int channels = juce::jmin(numChannels, (int)block.getNumChannels());
+    
+    for (int first = 0, p = 0; first < channels; first += 2, ++p)
+    {
+        auto pairBlock = block.getSubsetChannelBlock((size_t)first, (size_t)juce::jmin(2, channels - first));
+        pairs[(size_t)p]->process(juce::dsp::ProcessContextReplacing<float>(pairBlock));
+    }
+}
+
+void MultichannelConvolution::loadImpulseResponse(const juce::File& file,
+                                                  juce::dsp::Convolution::Stereo stereo,
+                                                  juce::dsp::Convolution::Trim trim,
+                                                  size_t size,
+                                                  juce::dsp::Convolution::Normalise normalise)
+{
+    for (auto& pair : pairs)
+        pair->loadImpulseResponse(file, stereo, trim, size, normalise);
+}
+
+void MultichannelConvolution::loadImpulseResponse(juce::AudioBuffer<float>&& buffer, double bufferSampleRate,
+                                                  juce::dsp::Convolution::Stereo stereo,
+                                                  juce::dsp::Convolution::Trim trim,
+                                                  juce::dsp::Convolution::Normalise normalise)
+{
+    // Each pair takes ownership of its copy.
+    for (int p = 1; p < maxPairs; ++p)
+    {
+        juce::AudioBuffer<float> copy(buffer);
+        pairs[(size_t)p]->loadImpulseResponse(std::move(copy), bufferSampleRate, stereo, trim, normalise);
+    }
+    pairs[0]->loadImpulseResponse(std::move(buffer), bufferSampleRate, stereo, trim, normalise);
+}
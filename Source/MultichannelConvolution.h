@@ -0,0 +1,41 @@
+#pragma once
+#include <juce_dsp/juce_dsp.h>
+#include <array>
+#include <memory>
+
+// juce::dsp::Convolution for more than two channels: one convolution per
+// channel pair, all fed the same impulse response (a stereo IR goes to
+// each pair as left/right) and loaded through one shared background queue.
+// Every channel gets the same filter and the same latency, so a chain of
+// any width up to maxChannels stays time-aligned.
+class MultichannelConvolution
+{
+public:
+    static constexpr int maxChannels = 8;
+    
+    MultichannelConvolution();
+    
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void reset();
+    void process(const juce::dsp::ProcessContextReplacing<float>& context);
+    
+    // Any thread; like Convolution, the new IR is swapped in without locking.
+    void loadImpulseResponse(const juce::File& file,
+                             juce::dsp::Convolution::Stereo stereo,
+                             juce::dsp::Convolution::Trim trim,
+                             size_t size,
+                             juce::dsp::Convolution::Normalise normalise);
+    void loadImpulseResponse(juce::AudioBuffer<float>&& buffer, double bufferSampleRate,
+                             juce::dsp::Convolution::Stereo stereo,
+                             juce::dsp::Convolution::Trim trim,
+                             juce::dsp::Convolution::Normalise normalise);
+    
+private:
+    static constexpr int maxPairs = maxChannels / 2;
+    
+    juce::dsp::ConvolutionMessageQueue loadQueue;
+    std::array<std::unique_ptr<juce::dsp::Convolution>, maxPairs> pairs;
+    int numChannels = 0;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MultichannelConvolution)
+};
@@ -0,0 +1,275 @@
+#include "NoiseSuppressor.h"
+
+NoiseSuppressor::NoiseSuppressor() : Thread("NoiseProfile")
+{
+    for (int n = 0; n < fftSize; ++n)
+        window[(size_t)n] = std::sqrt(0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * (float)n / (float)fftSize));
+    
+    for (auto& slot : profileSlots)
+        slot.fill(0.0f);
+    
+    startThread(juce::Thread::Priority::low);
+}
+
+NoiseSuppressor::~NoiseSuppressor()
+{
+    stopThread(2000);
+}
+
+void NoiseSuppressor::prepare(double sampleRate, int numChannels)
+{
+    numChannelsPrepared = juce::jmax(1, numChannels);
+    channels.assign((size_t)numChannelsPrepared, ChannelState());
+    
+    // ~20 ms gain smoothing, independent of the sample rate.
+    gainSmoothing = std::exp(-(float)hopSize / (0.02f * (float)sampleRate));
+    wetStep = (float)hopSize / (bypassFadeSeconds * (float)sampleRate);
+    
+    reset();
+}
+
+void NoiseSuppressor::reset()
+{
+    resetOverlap();
+    resetRequested.store(true);
+}
+
+void NoiseSuppressor::resetOverlap() noexcept
+{
+    for (auto& state : channels)
+    {
+        state.analysis.fill(0.0f);
+        state.accumulator.fill(0.0f);
+        state.inputHop.fill(0.0f);
+        state.outputHop.fill(0.0f);
+        state.smoothedGain.fill(1.0f);
+    }
+    
+    hopPosition = 0;
+    overlapPrimed = false;
+}
+
+void NoiseSuppressor::setLearning(bool shouldLearn)
+{
+    learning.store(shouldLearn);
+    if (!shouldLearn)
+        mode.store((int)Mode::learned);
+}
+
+void NoiseSuppressor::process(juce::AudioBuffer<float>& buffer, int numSamples)
+{
+    const int numChannels = juce::jmin(numChannelsPrepared, buffer.getNumChannels());
+    int pos = 0;
+    
+    while (pos < numSamples)
+    {
+        const int chunk = juce::jmin(numSamples - pos, hopSize - hopPosition);
+        
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto* data = buffer.getWritePointer(ch, pos);
+            auto& state = channels[(size_t)ch];
+            juce::FloatVectorOperations::copy(state.inputHop.data() + hopPosition, data, chunk);
+            juce::FloatVectorOperations::copy(data, state.outputHop.data() + hopPosition, chunk);
+        }
+        
+        pos += chunk;
+        hopPosition += chunk;
+        
+        if (hopPosition == hopSize)
+        {
+            hopPosition = 0;
+            
+            const bool bypass = bypassed.load();
+            const bool synthesise = wetGain > 0.0f || !bypass;
+            const float startWet = wetGain;
+            if (bypass)
+                wetGain = juce::jmax(0.0f, wetGain - wetStep);
+            else if (overlapPrimed)
+                wetGain = juce::jmin(1.0f, wetGain + wetStep);
+            
+            // Fully bypassed: what's left in the accumulator would come back
+            // in as a stale half-frame.
+            if (!synthesise && overlapPrimed)
+                for (auto& state : channels)
+                    state.accumulator.fill(0.0f);
+            overlapPrimed = synthesise;
+            
+            framePower.fill(0.0f);
+            
+            for (int ch = 0; ch < numChannels; ++ch)
+                processFrame(channels[(size_t)ch], ch == 0, synthesise, startWet, wetGain);
+            
+            if (!synthesise)
+                continue;
+            
+            juce::FloatVectorOperations::multiply(framePower.data(), 1.0f / (float)numChannels, numBins);
+            
+            int start1, size1, start2, size2;
+            frameFifo.prepareToWrite(1, start1, size1, start2, size2);
+            if (size1 > 0)
+                frameQueue[(size_t)start1] = framePower;
+            frameFifo.finishedWrite(size1);
+        }
+    }
+}
+
+void NoiseSuppressor::processFrame(ChannelState& state, bool firstChannel, bool synthesise, float startWet, float endWet)
+{
+    std::copy(state.analysis.begin() + hopSize, state.analysis.end(), state.analysis.begin());
+    std::copy(state.inputHop.begin(), state.inputHop.end(), state.analysis.begin() + (fftSize - hopSize));
+    
+    // The oldest hop of the analysis frame is the input a full latency back,
+    // the same samples the accumulator's first hop is about to output.
+    if (!synthesise)
+    {
+        std::copy(state.analysis.begin(), state.analysis.begin() + hopSize, state.outputHop.begin());
+        return;
+    }
+    
+    const auto& profile = firstChannel ? acquireProfile() : profileSlots[(size_t)readSlot];
+    
+    juce::FloatVectorOperations::multiply(fftData.data(), state.analysis.data(), window.data(), fftSize);
+    juce::FloatVectorOperations::clear(fftData.data() + fftSize, fftSize);
+    fft.performRealOnlyForwardTransform(fftData.data(), true);
+    
+    constexpr float overSubtraction = 2.0f;
+    const float floorGain = juce::Decibels::decibelsToGain(-reductionDb.load());
+    const float smoothing = gainSmoothing;
+    
+    for (int k = 0; k < numBins; ++k)
+    {
+        auto& re = fftData[(size_t)k * 2];
+        auto& im = fftData[(size_t)k * 2 + 1];
+        const float power = re * re + im * im;
+        framePower[(size_t)k] += power;
+        
+        float gain = 1.0f;
+        if (profile[(size_t)k] > 0.0f)
+            gain = power > 0.0f ? juce::jmax(floorGain, 1.0f - overSubtraction * profile[(size_t)k] / power)
+                                : floorGain;
+        
+        auto& smoothed = state.smoothedGain[(size_t)k];
+        smoothed = smoothing * smoothed + (1.0f - smoothing) * gain;
+        re *= smoothed;
+        im *= smoothed;
+    }
+    
+    fft.performRealOnlyInverseTransform(fftData.data());
+    
+    std::copy(state.accumulator.begin() + hopSize, state.accumulator.end(), state.accumulator.begin());
+    std::fill(state.accumulator.begin() + (fftSize - hopSize), state.accumulator.end(), 0.0f);
+    
+    for (int n = 0; n < fftSize; ++n)
+        state.accumulator[(size_t)n] += fftData[(size_t)n] * window[(size_t)n];
+    
+    if (startWet == 1.0f && endWet == 1.0f)
+    {
+        std::copy(state.accumulator.begin(), state.accumulator.begin() + hopSize, state.outputHop.begin());
+        return;
+    }
+    
+    const float slope = (endWet - startWet) / (float)hopSize;
+    for (int n = 0; n < hopSize; ++n)
+    {
+        const float dry = state.analysis[(size_t)n];
+        state.outputHop[(size_t)n] = dry + (startWet + slope * (float)n) * (state.accumulator[(size_t)n] - dry);
+    }
+}
+
+const NoiseSuppressor::Spectrum& NoiseSuppressor::acquireProfile()
+{
+    if ((sharedSlot.load() & 4) != 0)
+        readSlot = sharedSlot.exchange(readSlot) & 3;
+    
+    return profileSlots[(size_t)readSlot];
+}
+
+void NoiseSuppressor::publishProfile()
+{
+    writeSlot = sharedSlot.exchange(writeSlot | 4) & 3;
+}
+
+void NoiseSuppressor::run()
+{
+    // Minimum statistics: follow drops immediately, rise ~1.6 dB/s, then
+    // compensate for the downward bias of tracking a minimum.
+    constexpr float powerSmoothing = 0.8f;
+    constexpr float riseFactor = 1.002f;
+    constexpr float minimumBias = 1.5f;
+    bool wasLearning = false;
+    
+    // The smoothed power spectra decay towards zero during silence.
+    const juce::ScopedNoDenormals noDenormals;
+    
+    while (!threadShouldExit())
+    {
+        wait(20);
+        
+        if (resetRequested.exchange(false))
+            estimateInitialised = false;
+        
+        const bool isLearningNow = learning.load();
+        if (isLearningNow && !wasLearning)
+        {
+            learnedSum.fill(0.0f);
+            learnedFrames = 0;
+        }
+        wasLearning = isLearningNow;
+        
+        int start1, size1, start2, size2;
+        frameFifo.prepareToRead(frameFifo.getNumReady(), start1, size1, start2, size2);
+        
+        const int numFrames = size1 + size2;
+        for (int i = 0; i < numFrames; ++i)
+        {
+            const auto& power = frameQueue[(size_t)(i < size1 ? start1 + i : start2 + i - size1)];
+            
+            if (isLearningNow)
+            {
+                juce::FloatVectorOperations::add(learnedSum.data(), power.data(), numBins);
+                ++learnedFrames;
+            }
+            
+            if (!estimateInitialised)
+            {
+                smoothedPower = power;
+                noiseEstimate = power;
+                estimateInitialised = true;
+                continue;
+            }
+            
+            for (int k = 0; k < numBins; ++k)
+            {
+                auto& s = smoothedPower[(size_t)k];
+                auto& n = noiseEstimate[(size_t)k];
+                s = powerSmoothing * s + (1.0f - powerSmoothing) * power[(size_t)k];
+                n = s < n ? s : juce::jmin(s, n * riseFactor + 1.0e-12f);
+            }
+        }
+        
+        frameFifo.finishedRead(numFrames);
+        
+        if (numFrames == 0)
+            continue;
+        
+        auto& slot = profileSlots[(size_t)writeSlot];
+        
+        if (isLearningNow && learnedFrames > 0)
+        {
+            juce::FloatVectorOperations::copy(slot.data(), learnedSum.data(), numBins);
+            juce::FloatVectorOperations::multiply(slot.data(), 1.0f / (float)learnedFrames, numBins);
+        }
+        else if (getMode() == Mode::adaptive)
+        {
+            juce::FloatVectorOperations::copy(slot.data(), noiseEstimate.data(), numBins);
+            juce::FloatVectorOperations::multiply(slot.data(), minimumBias, numBins);
+        }
+        else
+        {
+            continue;
+        }
+        
+        publishProfile();
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <juce_dsp/juce_dsp.h>
+#include <array>
+#include <vector>
+
+// STFT spectral-subtraction denoiser: 512-point frames, 256-sample hop,
+// sqrt-Hann analysis and synthesis windows, overlap-add. The audio thread
+// only applies gains; power frames are pushed through a lock-free FIFO to a
+// worker that estimates the noise floor (continuous minimum tracking, or an
+// average captured while learning) and publishes it through a triple buffer.
+// Channels share nothing but the noise profile, so each instance is cheap
+// and independent and several engines can run side by side on a host.
+class NoiseSuppressor : private juce::Thread
+{
+public:
+    enum class Mode { adaptive = 0, learned };
+    
+    static constexpr int fftOrder = 9;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int hopSize = fftSize / 2;
+    static constexpr int numBins = fftSize / 2 + 1;
+    
+    NoiseSuppressor();
+    ~NoiseSuppressor() override;
+    
+    // The profile worker, for CPU pinning.
+    using juce::Thread::getThreadId;
+    
+    void prepare(double sampleRate, int numChannels);
+    void reset();
+    
+    // Audio thread: drops the overlap-add state but keeps the noise profile,
+    // for when the stage comes back on after being bypassed.
+    void resetOverlap() noexcept;
+    void process(juce::AudioBuffer<float>& buffer, int numSamples);
+    
+    // Crossfades to the input delayed by the same latency, so the output
+    // neither jumps in time nor dips; once it is fully dry the FFTs stop.
+    // For the overload governor.
+    void setBypassed(bool shouldBypass) { bypassed.store(shouldBypass); }
+    bool isBypassed() const { return bypassed.load(); }
+    
+    void setMode(Mode newMode) { mode.store((int)newMode); }
+    Mode getMode() const { return (Mode)mode.load(); }
+    void setReduction(float dB) { reductionDb.store(dB); }
+    float getReduction() const { return reductionDb.load(); }
+    
+    // While learning, the profile is the running average of everything that
+    // comes in; it is frozen (and the mode switches to learned) on stop.
+    void setLearning(bool shouldLearn);
+    bool isLearning() const { return learning.load(); }
+    
+    int getLatencySamples() const { return fftSize; }
+    
+private:
+    struct ChannelState
+    {
+        std::array<float, fftSize> analysis {};
+        std::array<float, fftSize> accumulator {};
+        std::array<float, hopSize> inputHop {};
+        std::array<float, hopSize> outputHop {};
+        std::array<float, numBins> smoothedGain {};
+    };
+    
+    using Spectrum = std::array<float, numBins>;
+    
+    void run() override;
+    void processFrame(ChannelState& state, bool firstChannel, bool synthesise, float startWet, float endWet);
+    void publishProfile();
+    const Spectrum& acquireProfile();
+    
+    juce::dsp::FFT fft { fftOrder };
+    std::array<float, fftSize> window {};
+    std::array<float, fftSize * 2> fftData {};
+    Spectrum framePower {};
+    
+    std::vector<ChannelState> channels;
+    int numChannelsPrepared = 0;
+    int hopPosition = 0;
+    float gainSmoothing = 0.5f;
+    
+    // Bypass crossfade (audio thread). The accumulator only holds a full
+    // overlap once a frame has been synthesised into it, so coming back from
+    // a full bypass runs one frame dry before fading in.
+    static constexpr float bypassFadeSeconds = 0.02f;
+    float wetGain = 1.0f;
+    float wetStep = 1.0f;
+    bool overlapPrimed = false;
+    
+    // Audio thread -> worker: power spectra of the summed channels.
+    static constexpr int fifoFrames = 64;
+    juce::AbstractFifo frameFifo { fifoFrames };
+    std::array<Spectrum, fifoFrames> frameQueue;
+    
+    // Worker -> audio thread: noise profile triple buffer. The index in
+    // sharedSlot carries a "fresh" flag in bit 2.
+    std::array<Spectrum, 3> profileSlots;
+    std::atomic<int> sharedSlot { 1 };
+    int writeSlot = 0;
+    int readSlot = 2;
+    
+    // Worker-only estimation state.
+    Spectrum smoothedPower {};
+    Spectrum noiseEstimate {};
+    Spectrum learnedSum {};
+    int learnedFrames = 0;
+    bool estimateInitialised = false;
+    
+    std::atomic<int> mode { (int)Mode::adaptive };
+    std::atomic<float> reductionDb { 18.0f };
+    std::atomic<bool> learning { false };
+    std::atomic<bool> resetRequested { false };
+    std::atomic<bool> bypassed { false };
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(NoiseSuppressor)
+};
@@ -0,0 +1,146 @@
+#include "OverloadGovernor.h"
+
+OverloadGovernor::OverloadGovernor() : Thread("OverloadGovernor")
+{
+}
+
+OverloadGovernor::~OverloadGovernor()
+{
+    stopThread(2000);
+}
+
+void OverloadGovernor::setEnabled(bool shouldBeEnabled)
+{
+    if (shouldBeEnabled == isThreadRunning())
+        return;
+    
+    if (shouldBeEnabled)
+    {
+        startMs = juce::Time::getMillisecondCounterHiRes();
+        blockCount.store(0);
+        loadSum.store(0.0f);
+        overruns.store(0);
+        peakLoad.store(0.0f);
+        active.store(true);
+        startThread(juce::Thread::Priority::normal);
+        return;
+    }
+    
+    active.store(false);
+    stopThread(2000);
+    
+    // Disabling hands back everything that was shed.
+    while (!shedStack.empty())
+    {
+        const int index = shedStack.back();
+        shedStack.pop_back();
+        steps[(size_t)index].restore();
+        log("restore", steps[(size_t)index].name, 0.0f, 0.0f, 0);
+    }
+    numShed.store(0);
+}
+
+void OverloadGovernor::run()
+{
+    int overloadedWindows = 0;
+    int headroomWindows = 0;
+    int holdWindows = 0;
+    int restoreWindows = baseRestoreWindows;
+    int windowsSinceRestore = flapWindows;
+    
+    while (!threadShouldExit())
+    {
+        wait(windowMs);
+        
+        const int blocks = blockCount.exchange(0);
+        const float sum = loadSum.exchange(0.0f);
+        const int overrunCount = overruns.exchange(0);
+        const float peak = peakLoad.exchange(0.0f);
+        
+        // No audio (device stopped or switching): nothing to judge.
+        if (blocks == 0)
+            continue;
+        
+        const float average = sum / (float)blocks;
+        const bool overloaded = average > overloadAverage || overrunCount > 1;
+        const bool headroom = average < headroomAverage && overrunCount == 0;
+        
+        overloadedWindows = overloaded ? overloadedWindows + 1 : 0;
+        headroomWindows = headroom ? headroomWindows + 1 : 0;
+        ++windowsSinceRestore;
+        
+        if (holdWindows > 0)
+        {
+            --holdWindows;
+            continue;
+        }
+        
+        if (overloadedWindows >= overloadWindows)
+        {
+            overloadedWindows = 0;
+            
+            auto next = std::find_if(steps.begin(), steps.end(), [](const Step& s) { return s.canShed(); });
+            if (next == steps.end())
+            {
+                log("overloaded, nothing left to shed", {}, average, peak, overrunCount);
+                holdWindows = shedHoldWindows;
+                continue;
+            }
+            
+            // Shedding again right after a restore: wait longer next time.
+            if (windowsSinceRestore < flapWindows)
+                restoreWindows = juce::jmin(maxRestoreWindows, restoreWindows * 2);
+            
+            next->shed();
+            shedStack.push_back((int)std::distance(steps.begin(), next));
+            numShed.store((int)shedStack.size());
+            log("shed", next->name, average, peak, overrunCount);
+            holdWindows = shedHoldWindows;
+            headroomWindows = 0;
+        }
+        else if (!shedStack.empty() && headroomWindows >= restoreWindows)
+        {
+            const int index = shedStack.back();
+            shedStack.pop_back();
+            numShed.store((int)shedStack.size());
+            
+            steps[(size_t)index].restore();
+            log("restore", steps[(size_t)index].name, average, peak, overrunCount);
+            headroomWindows = 0;
+            holdWindows = shedHoldWindows;
+            windowsSinceRestore = 0;
+        }
+        else if (shedStack.empty() && headroomWindows >= maxRestoreWindows)
+        {
+            // A long clean stretch forgives earlier flapping.
+            restoreWindows = baseRestoreWindows;
+        }
+    }
+}
+
+void OverloadGovernor::log(const juce::String& action, const juce::String& stepName,
+                           float averageLoad, float peak, int overrunCount)
+{
+    const double seconds = (juce::Time::getMillisecondCounterHiRes() - startMs) * 0.001;
+    
+    juce::String line;
+    line << "t=" << juce::String(seconds, 3) << "s " << action;
+    if (stepName.isNotEmpty())
+        line << " '" << stepName << "'";
+    line << " load avg=" << juce::String(averageLoad, 2)
+         << " peak=" << juce::String(peak, 2)
+         << " overruns=" << overrunCount;
+    
+    juce::Logger::writeToLog("[governor] " + line);
+    
+    const juce::ScopedLock sl(logLock);
+    decisionLog.add(line);
+    if (decisionLog.size() > maxLogLines)
+        decisionLog.removeRange(0, decisionLog.size() - maxLogLines);
+}
+
+juce::StringArray OverloadGovernor::getDecisionLog() const
+{
+    const juce::ScopedLock sl(logLock);
+    return decisionLog;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+// Watches how long each callback takes against its deadline (the block's
+// duration) and, under sustained overload, sheds work one step at a time
+// from a ladder the engine registers, cheapest quality loss first. Once
+// there has been headroom for a while the most recent step is restored; a
+// step that has to be shed again soon after waits longer before the next
+// restore, so the chain doesn't flap. Every decision is logged with the
+// load figures that led to it.
+//
+// The audio thread only records timings (atomics); decisions and the steps
+// themselves run on the governor's own thread.
+class OverloadGovernor : private juce::Thread
+{
+public:
+    struct Step
+    {
+        juce::String name;
+        std::function<bool()> canShed;   // stage enabled and not shed yet
+        std::function<void()> shed;
+        std::function<void()> restore;
+    };
+    
+    OverloadGovernor();
+    ~OverloadGovernor() override;
+    
+    // Register before enable(); ordered from first to last resort.
+    void addStep(Step step) { steps.push_back(std::move(step)); }
+    
+    void setEnabled(bool shouldBeEnabled);
+    bool isEnabled() const { return isThreadRunning(); }
+    
+    // Times one callback against the duration of the audio it produced.
+    class ScopedBlockTimer
+    {
+    public:
+        ScopedBlockTimer(OverloadGovernor& g, int numSamples, double sampleRate) noexcept
+            : governor(g), deadlineTicks(juce::Time::secondsToHighResolutionTicks(numSamples / sampleRate)),
+              startTicks(juce::Time::getHighResolutionTicks())
+        {
+        }
+        
+        ~ScopedBlockTimer()
+        {
+            if (governor.active.load(std::memory_order_relaxed) && deadlineTicks > 0)
+                governor.recordBlock((double)(juce::Time::getHighResolutionTicks() - startTicks) / (double)deadlineTicks);
+        }
+    
+    private:
+        OverloadGovernor& governor;
+        const juce::int64 deadlineTicks;
+        const juce::int64 startTicks;
+    };
+    
+    int getNumShedSteps() const { return numShed.load(); }
+    
+    // The most recent decisions, oldest first.
+    juce::StringArray getDecisionLog() const;
+    
+private:
+    void run() override;
+    
+    // Audio thread; load is elapsed time over the block's duration.
+    void recordBlock(double blockLoad) noexcept
+    {
+        const float load = (float)blockLoad;
+        // No fetch_add on atomic<float> before C++20.
+        float sum = loadSum.load(std::memory_order_relaxed);
+        while (!loadSum.compare_exchange_weak(sum, sum + load, std::memory_order_relaxed)) {}
+        blockCount.fetch_add(1, std::memory_order_relaxed);
+        if (load >= 1.0f)
+            overruns.fetch_add(1, std::memory_order_relaxed);
+        
+        float peak = peakLoad.load(std::memory_order_relaxed);
+        while (load > peak && !peakLoad.compare_exchange_weak(peak, load, std::memory_order_relaxed)) {}
+    }
+    
+    void log(const juce::String& action, const juce::String& stepName, float averageLoad, float peak, int overrunCount);
+    
+    static constexpr int windowMs = 100;
+    static constexpr float overloadAverage = 0.9f;   // of the deadline
+    static constexpr float headroomAverage = 0.6f;
+    static constexpr int overloadWindows = 3;          // sustained for 300 ms
+    static constexpr int shedHoldWindows = 10;         // let a shed settle for 1 s
+    static constexpr int baseRestoreWindows = 50;      // 5 s of headroom
+    static constexpr int maxRestoreWindows = 600;
+    static constexpr int flapWindows = 100;            // re-shed within 10 s
+    static constexpr int maxLogLines = 200;
+    
+    std::vector<Step> steps;
+    std::vector<int> shedStack;   // indices into steps, most recent last
+    std::atomic<int> numShed { 0 };
+    std::atomic<bool> active { false };
+    
+    std::atomic<float> loadSum { 0.0f };
+    std::atomic<int> blockCount { 0 };
+    std::atomic<int> overruns { 0 };
+    std::atomic<float> peakLoad { 0.0f };
+    
+    double startMs = 0.0;
+    
+    mutable juce::CriticalSection logLock;
+    juce::StringArray decisionLog;
+};
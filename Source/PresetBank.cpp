@@ -0,0 +1,101 @@
+#include "PresetBank.h"
+#include <algorithm>
+
+void PresetBank::store(const juce::String& name, AudioEngine::Snapshot snapshot)
+{
+    for (auto& preset : presets)
+    {
+        if (preset.name == name)
+        {
+            preset.snapshot = std::move(snapshot);
+            return;
+        }
+    }
+    
+    presets.push_back({ name, std::move(snapshot) });
+}
+
+void PresetBank::remove(const juce::String& name)
+{
+    presets.erase(std::remove_if(presets.begin(), presets.end(),
+                                 [&name](const Preset& p) { return p.name == name; }),
+                  presets.end());
+}
+
+const PresetBank::Preset* PresetBank::find(const juce::String& name) const
+{
+    for (auto& preset : presets)
+        if (preset.name == name)
+            return &preset;
+    
+    return nullptr;
+}
+
+juce::StringArray PresetBank::getNames() const
+{
+    juce::StringArray names;
+    for (auto& preset : presets)
+        names.add(preset.name);
+    return names;
+}
+
+std::unique_ptr<juce::XmlElement> PresetBank::toXml() const
+{
+    auto xml = std::make_unique<juce::XmlElement>("Presets");
+    xml->setAttribute("crossfadeMs", crossfadeMs);
+    
+    for (auto& preset : presets)
+    {
+        auto& s = preset.snapshot;
+        auto* e = xml->createNewChildElement("Preset");
+        e->setAttribute("name", preset.name);
+        e->setAttribute("boost", s.boostDb);
+        e->setAttribute("bass", s.bassDb);
+        e->setAttribute("mid", s.midDb);
+        e->setAttribute("treble", s.trebleDb);
+        e->setAttribute("autoGain", s.autoGain);
+        e->setAttribute("autoGainTarget", s.autoGainTarget);
+        e->setAttribute("linearPhase", s.linearPhase);
+        e->setAttribute("noiseSuppression", s.noiseSuppression);
+        e->setAttribute("noiseReduction", s.noiseReduction);
+        e->setAttribute("clipper", s.clipper);
+        
+        if (s.pluginState.getSize() > 0)
+        {
+            e->setAttribute("plugin", s.pluginIdentifier);
+            e->setAttribute("pluginState", s.pluginState.toBase64Encoding());
+        }
+    }
+    
+    return xml;
+}
+
+void PresetBank::restoreFromXml(const juce::XmlElement& xml)
+{
+    presets.clear();
+    setCrossfadeMs(xml.getDoubleAttribute("crossfadeMs", 250.0));
+    
+    for (auto* e : xml.getChildWithTagNameIterator("Preset"))
+    {
+        Preset preset;
+        preset.name = e->getStringAttribute("name");
+        if (preset.name.isEmpty())
+            continue;
+        
+        auto& s = preset.snapshot;
+        s.boostDb = (float)e->getDoubleAttribute("boost");
+        s.bassDb = (float)e->getDoubleAttribute("bass");
+        s.midDb = (float)e->getDoubleAttribute("mid");
+        s.trebleDb = (float)e->getDoubleAttribute("treble");
+        s.autoGain = e->getBoolAttribute("autoGain");
+        s.autoGainTarget = (float)e->getDoubleAttribute("autoGainTarget", -18.0);
+        s.linearPhase = e->getBoolAttribute("linearPhase");
+        s.noiseSuppression = e->getBoolAttribute("noiseSuppression");
+        s.noiseReduction = (float)e->getDoubleAttribute("noiseReduction", 18.0);
+        s.clipper = e->getBoolAttribute("clipper");
+        s.pluginIdentifier = e->getStringAttribute("plugin");
+        s.pluginState.fromBase64Encoding(e->getStringAttribute("pluginState"));
+        
+        presets.push_back(std::move(preset));
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "AudioEngine.h"
+#include <vector>
+
+// Named engine snapshots, kept in memory (plugin state blobs included) so a
+// recall is just AudioEngine::recallSnapshot. Serialised to XML for the
+// settings file. Message thread only.
+class PresetBank
+{
+public:
+    struct Preset
+    {
+        juce::String name;
+        AudioEngine::Snapshot snapshot;
+    };
+    
+    // Replaces any preset with the same name.
+    void store(const juce::String& name, AudioEngine::Snapshot snapshot);
+    void remove(const juce::String& name);
+    const Preset* find(const juce::String& name) const;
+    juce::StringArray getNames() const;
+    
+    void setCrossfadeMs(double ms) { crossfadeMs = juce::jmax(0.0, ms); }
+    double getCrossfadeMs() const { return crossfadeMs; }
+    
+    std::unique_ptr<juce::XmlElement> toXml() const;
+    void restoreFromXml(const juce::XmlElement& xml);
+    
+private:
+    std::vector<Preset> presets;
+    double crossfadeMs = 250.0;
+};
@@ -0,0 +1,173 @@
+#include "RealtimeSafety.h"
+
+#if MICBOOSTER_RT_CHECKS
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if defined(__GLIBC__)
+ #include <dlfcn.h>
+ #include <execinfo.h>
+ #include <poll.h>
+ #include <pthread.h>
+ #include <unistd.h>
+ #define MICBOOSTER_RT_INTERPOSE_LIBC 1
+#else
+ #include <juce_core/juce_core.h>
+ #define MICBOOSTER_RT_INTERPOSE_LIBC 0
+#endif
+
+namespace
+{
+    thread_local int realtimeDepth = 0;
+    thread_local bool reporting = false;
+    std::atomic<int> numViolations { 0 };
+    
+    void report(const char* what) noexcept
+    {
+        if (realtimeDepth == 0 || reporting)
+            return;
+        
+        // Everything below may allocate or lock itself; don't recurse.
+        reporting = true;
+        const int count = ++numViolations;
+        
+        std::fprintf(stderr, "[rt-check] %s called on the audio thread (violation #%d)\n", what, count);
+       
+       #if MICBOOSTER_RT_INTERPOSE_LIBC
+        void* frames[64];
+        const int numFrames = backtrace(frames, 64);
+        backtrace_symbols_fd(frames, numFrames, 2);
+       #else
+        std::fprintf(stderr, "%s\n", juce::SystemStats::getStackBacktrace().toRawUTF8());
+       #endif
+        std::fflush(stderr);
+        
+        if (std::getenv("MICBOOSTER_RT_ABORT") != nullptr)
+            std::abort();
+        
+        reporting = false;
+    }
+}
+
+namespace RealtimeSafety
+{
+    void enterRealtimeSection() noexcept { ++realtimeDepth; }
+    void exitRealtimeSection() noexcept { --realtimeDepth; }
+    int getNumViolations() noexcept { return numViolations.load(); }
+}
+
+#if MICBOOSTER_RT_INTERPOSE_LIBC
+
+// glibc: interpose the allocator directly so C allocations and operator new
+// are both caught, and wrap the blocking calls through RTLD_NEXT.
+extern "C"
+{
+    void* __libc_malloc(size_t);
+    void* __libc_calloc(size_t, size_t);
+    void* __libc_realloc(void*, size_t);
+    void* __libc_memalign(size_t, size_t);
+    void __libc_free(void*);
+    
+    void* malloc(size_t size)
+    {
+        report("malloc");
+        return __libc_malloc(size);
+    }
+    
+    void* calloc(size_t count, size_t size)
+    {
+        report("calloc");
+        return __libc_calloc(count, size);
+    }
+    
+    void* realloc(void* ptr, size_t size)
+    {
+        report("realloc");
+        return __libc_realloc(ptr, size);
+    }
+    
+    void* memalign(size_t alignment, size_t size)
+    {
+        report("memalign");
+        return __libc_memalign(alignment, size);
+    }
+    
+    int posix_memalign(void** result, size_t alignment, size_t size)
+    {
+        report("posix_memalign");
+        *result = __libc_memalign(alignment, size);
+        return *result != nullptr ? 0 : ENOMEM;
+    }
+    
+    void free(void* ptr)
+    {
+        if (ptr != nullptr)
+            report("free");
+        __libc_free(ptr);
+    }
+}
+
+#define MICBOOSTER_RT_WRAP(ret, name, params, args)                        \
+    extern "C" ret name params                                             \
+    {                                                                      \
+        report(#name);                                                     \
+        using Fn = ret (*) params;                                         \
+        static const Fn real = (Fn) dlsym(RTLD_NEXT, #name);               \
+        return real args;                                                  \
+    }
+
+MICBOOSTER_RT_WRAP(int, pthread_mutex_lock, (pthread_mutex_t* m), (m))
+MICBOOSTER_RT_WRAP(int, pthread_rwlock_rdlock, (pthread_rwlock_t* l), (l))
+MICBOOSTER_RT_WRAP(int, pthread_rwlock_wrlock, (pthread_rwlock_t* l), (l))
+MICBOOSTER_RT_WRAP(int, nanosleep, (const struct timespec* t, struct timespec* r), (t, r))
+MICBOOSTER_RT_WRAP(int, usleep, (useconds_t us), (us))
+MICBOOSTER_RT_WRAP(ssize_t, read, (int fd, void* buf, size_t n), (fd, buf, n))
+MICBOOSTER_RT_WRAP(ssize_t, write, (int fd, const void* buf, size_t n), (fd, buf, n))
+MICBOOSTER_RT_WRAP(int, poll, (struct pollfd* fds, nfds_t n, int timeout), (fds, n, timeout))
+MICBOOSTER_RT_WRAP(int, fsync, (int fd), (fd))
+
+#undef MICBOOSTER_RT_WRAP
+
+#else
+
+// Elsewhere only the C++ allocator can be replaced portably.
+void* operator new(std::size_t size)
+{
+    report("operator new");
+    if (void* p = std::malloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    report("operator new[]");
+    if (void* p = std::malloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if (ptr != nullptr)
+        report("operator delete");
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    if (ptr != nullptr)
+        report("operator delete[]");
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept { operator delete(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { operator delete[](ptr); }
+
+#endif
+
+#endif
@@ -0,0 +1,28 @@
+#pragma once
+
+// Debug/CI aid. When built with MICBOOSTER_RT_CHECKS, every allocation,
+// mutex lock and blocking system call made on a thread that is inside a
+// ScopedRealtimeSection is reported to stderr with a stack trace (and
+// aborts if MICBOOSTER_RT_ABORT is set in the environment). In normal
+// builds the section is an empty object.
+namespace RealtimeSafety
+{
+#if MICBOOSTER_RT_CHECKS
+    void enterRealtimeSection() noexcept;
+    void exitRealtimeSection() noexcept;
+    int getNumViolations() noexcept;
+#else
+    inline void enterRealtimeSection() noexcept {}
+    inline void exitRealtimeSection() noexcept {}
+    inline int getNumViolations() noexcept { return 0; }
+#endif
+
+    struct ScopedRealtimeSection
+    {
+        ScopedRealtimeSection() noexcept { enterRealtimeSection(); }
+        ~ScopedRealtimeSection() noexcept { exitRealtimeSection(); }
+        
+        ScopedRealtimeSection(const ScopedRealtimeSection&) = delete;
+        ScopedRealtimeSection& operator=(const ScopedRealtimeSection&) = delete;
+    };
+}
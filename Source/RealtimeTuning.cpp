@@ -0,0 +1,297 @@
+#include "RealtimeTuning.h"
+
+#if JUCE_LINUX
+ #include <cerrno>
+ #include <cstring>
+ #include <pthread.h>
+ #include <sched.h>
+ #include <sys/mman.h>
+ #include <sys/resource.h>
+ #include <sys/syscall.h>
+ #include <unistd.h>
+#endif
+
+namespace
+{
+    // Stack the callback (and a plugin inside it) is expected to touch.
+    constexpr int stackPrefaultBytes = 256 * 1024;
+    constexpr int pageBytes = 4096;
+    
+    // rtkit's defaults, for when its properties can't be read.
+    constexpr int rtkitMaxPriority = 20;
+    constexpr juce::int64 rtkitMaxRealtimeMicroseconds = 200000;
+}
+
+bool RealtimeTuning::Options::parseCommandLine(const juce::String& commandLine)
+{
+    juce::ArgumentList args("MicBooster", commandLine);
+    if (!args.containsOption("--rt"))
+        return false;
+    
+    auto cores = [&args](const char* name)
+    {
+        juce::Array<int> list;
+        for (auto& token : juce::StringArray::fromTokens(args.getValueForOption(name), ",", ""))
+            if (token.trim().containsOnly("0123456789") && token.trim().isNotEmpty())
+                list.addIfNotAlreadyThere(token.trim().getIntValue());
+        return list;
+    };
+    
+    enabled = true;
+    const auto priorityArg = args.getValueForOption("--rt-priority");
+    if (priorityArg.isNotEmpty())
+        priority = juce::jlimit(1, 99, priorityArg.getIntValue());
+    audioCores = cores("--rt-audio-cores");
+    workerCores = cores("--rt-worker-cores");
+    lockMemory = !args.containsOption("--rt-no-mlock");
+    return true;
+}
+
+//==============================================================================
+RealtimeTuning::RealtimeTuning() : Thread("RealtimeTuning")
+{
+}
+
+RealtimeTuning::~RealtimeTuning()
+{
+    stopThread(2000);
+}
+
+void RealtimeTuning::setOptions(const Options& newOptions)
+{
+    options = newOptions;
+    audioCoreMask = toMask(options.audioCores);
+    workerCoreMask = toMask(options.workerCores);
+    
+    if (options.enabled && !isThreadRunning())
+        startThread(juce::Thread::Priority::low);
+}
+
+void RealtimeTuning::lockMemory()
+{
+    if (!options.enabled || !options.lockMemory || lockedFuture)
+        return;
+
+#if JUCE_LINUX
+    // MCL_FUTURE under a finite RLIMIT_MEMLOCK would make later allocations
+    // fail outright, so it is only used when the limit allows it.
+    rlimit limit {};
+    const bool unlimited = getrlimit(RLIMIT_MEMLOCK, &limit) == 0 && limit.rlim_cur == RLIM_INFINITY;
+    const int flags = unlimited ? (MCL_CURRENT | MCL_FUTURE) : MCL_CURRENT;
+    
+    if (mlockall(flags) == 0)
+    {
+        lockedFuture = unlimited;
+        addReport(unlimited ? "mlockall: current and future pages locked"
+                            : "mlockall: current pages locked (RLIMIT_MEMLOCK "
+                              + juce::String((juce::int64)limit.rlim_cur) + " bytes, so not future ones)");
+    }
+    else
+    {
+        addReport("mlockall: failed (" + juce::String(std::strerror(errno)) + ")");
+    }
+#else
+    addReport("mlockall: not supported on this platform");
+#endif
+}
+
+void RealtimeTuning::pinWorkerThread(juce::Thread::ThreadID thread, const juce::String& name)
+{
+    if (!options.enabled || workerCoreMask == 0 || thread == nullptr)
+        return;
+
+#if JUCE_LINUX
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int core = 0; core < 64; ++core)
+        if ((workerCoreMask >> core) & 1)
+            CPU_SET(core, &set);
+    
+    const int result = pthread_setaffinity_np((pthread_t)thread, sizeof(set), &set);
+    addReport(name + " affinity " + describeCores(options.workerCores) + ": "
+              + (result == 0 ? juce::String("ok") : "failed (" + juce::String(std::strerror(result)) + ")"));
+#else
+    addReport(name + " affinity: not supported on this platform");
+#endif
+}
+
+void RealtimeTuning::prefault(juce::AudioBuffer<float>& buffer)
+{
+    if (!options.enabled)
+        return;
+    
+    // clear() skips buffers already flagged clear, so write explicitly.
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        juce::FloatVectorOperations::fill(buffer.getWritePointer(ch), 0.0f, buffer.getNumSamples());
+    
+    prefaultedBytes += (juce::int64)buffer.getNumChannels() * buffer.getNumSamples() * (juce::int64)sizeof(float);
+}
+
+void RealtimeTuning::tuneAudioThread() noexcept
+{
+    audioThreadPending.store(false);
+
+#if JUCE_LINUX
+    audioThreadId.store((int)syscall(SYS_gettid));
+    
+    sched_param param {};
+    param.sched_priority = options.priority;
+    schedulingResult.store(pthread_setschedparam(pthread_self(), SCHED_FIFO, &param));
+    
+    if (audioCoreMask != 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int core = 0; core < 64; ++core)
+            if ((audioCoreMask >> core) & 1)
+                CPU_SET(core, &set);
+        affinityResult.store(pthread_setaffinity_np(pthread_self(), sizeof(set), &set));
+    }
+    
+    volatile char stack[stackPrefaultBytes];
+    for (int i = 0; i < stackPrefaultBytes; i += pageBytes)
+        stack[i] = 0;
+#endif
+
+    audioThreadTuned.store(true);
+}
+
+void RealtimeTuning::run()
+{
+    while (!threadShouldExit())
+    {
+        wait(100);
+        
+        if (!audioThreadTuned.exchange(false))
+            continue;
+
+#if JUCE_LINUX
+        const int scheduling = schedulingResult.load();
+        if (scheduling == 0)
+        {
+            addReport("audio thread SCHED_FIFO " + juce::String(options.priority) + ": ok");
+        }
+        else
+        {
+            // Not permitted directly (no CAP_SYS_NICE or rtprio limit): ask
+            // rtkit, which lowers the priority to what it hands out.
+            int priority = options.priority;
+            juce::String error;
+            if (requestRealtimeFromRtkit(audioThreadId.load(), priority, error))
+                addReport("audio thread SCHED_FIFO " + juce::String(priority) + " via rtkit: ok ("
+                          + juce::String(std::strerror(scheduling)) + " directly)");
+            else
+                addReport("audio thread SCHED_FIFO: failed (" + juce::String(std::strerror(scheduling))
+                          + "; rtkit: " + error + ")");
+        }
+        
+        if (audioCoreMask != 0)
+        {
+            const int affinity = affinityResult.load();
+            addReport("audio thread affinity " + describeCores(options.audioCores) + ": "
+                      + (affinity == 0 ? juce::String("ok") : "failed (" + juce::String(std::strerror(affinity)) + ")"));
+        }
+        
+        addReport("pre-faulted " + juce::File::descriptionOfSizeInBytes(prefaultedBytes.load()) + " of buffers and "
+                  + juce::File::descriptionOfSizeInBytes(stackPrefaultBytes) + " of audio thread stack");
+#else
+        addReport("audio thread scheduling and affinity: not supported on this platform");
+#endif
+    }
+}
+
+bool RealtimeTuning::requestRealtimeFromRtkit(int threadId, int& priority, juce::String& error)
+{
+#if JUCE_LINUX
+    auto busctl = [&error](const juce::StringArray& arguments, juce::String& output)
+    {
+        juce::ChildProcess process;
+        juce::StringArray command { "busctl", "--system" };
+        command.addArray(arguments);
+        if (!process.start(command, juce::ChildProcess::wantStdOut | juce::ChildProcess::wantStdErr))
+        {
+            error = "busctl not available";
+            return false;
+        }
+        
+        output = process.readAllProcessOutput().trim();
+        if (process.getExitCode() != 0)
+        {
+            error = output.isNotEmpty() ? output : "request refused";
+            return false;
+        }
+        return true;
+    };
+    
+    // Replies look like "i 20" or "x 200000".
+    auto property = [&busctl](const char* name, juce::int64 fallback)
+    {
+        juce::String output;
+        const juce::StringArray arguments { "get-property", "org.freedesktop.RealtimeKit1",
+                                            "/org/freedesktop/RealtimeKit1", "org.freedesktop.RealtimeKit1", name };
+        if (!busctl(arguments, output))
+            return fallback;
+        return output.fromFirstOccurrenceOf(" ", false, false).trim().getLargeIntValue();
+    };
+    
+    priority = juce::jmin(priority, (int)property("MaxRealtimePriority", rtkitMaxPriority));
+    
+    // rtkit refuses processes whose RLIMIT_RTTIME is unset or above its cap.
+    const auto maxRealtimeMicroseconds = (rlim_t)property("RTTimeUSecMax", rtkitMaxRealtimeMicroseconds);
+    rlimit rttime {};
+    if (getrlimit(RLIMIT_RTTIME, &rttime) != 0 || rttime.rlim_max == RLIM_INFINITY
+        || rttime.rlim_max > maxRealtimeMicroseconds)
+    {
+        rttime.rlim_cur = rttime.rlim_max = maxRealtimeMicroseconds;
+        if (setrlimit(RLIMIT_RTTIME, &rttime) != 0)
+        {
+            error = "couldn't set RLIMIT_RTTIME (" + juce::String(std::strerror(errno)) + ")";
+            return false;
+        }
+    }
+    
+    // rtkit looks the thread up under the caller's process, and the caller
+    // here is busctl, so the process has to be named explicitly.
+    const juce::StringArray arguments { "call", "org.freedesktop.RealtimeKit1", "/org/freedesktop/RealtimeKit1",
+                                        "org.freedesktop.RealtimeKit1", "MakeThreadRealtimeWithPID", "ttu",
+                                        juce::String((juce::int64)getpid()), juce::String(threadId),
+                                        juce::String(priority) };
+    juce::String output;
+    return busctl(arguments, output);
+#else
+    juce::ignoreUnused(threadId, priority);
+    error = "not supported on this platform";
+    return false;
+#endif
+}
+
+void RealtimeTuning::addReport(const juce::String& line)
+{
+    juce::Logger::writeToLog("[rt] " + line);
+    
+    const juce::ScopedLock sl(reportLock);
+    report.add(line);
+}
+
+juce::StringArray RealtimeTuning::getReport() const
+{
+    const juce::ScopedLock sl(reportLock);
+    return report;
+}
+
+juce::uint64 RealtimeTuning::toMask(const juce::Array<int>& cores)
+{
+    juce::uint64 mask = 0;
+    for (auto core : cores)
+        if (juce::isPositiveAndBelow(core, 64))
+            mask |= (juce::uint64)1 << core;
+    return mask;
+}
+
+juce::String RealtimeTuning::describeCores(const juce::Array<int>& cores)
+{
+    juce::StringArray names;
+    for (auto core : cores)
+        names.add(juce::String(core));
+    return "cpu " + names.joinIntoString(",");
+}
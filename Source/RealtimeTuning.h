@@ -0,0 +1,88 @@
+#pragma once
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <atomic>
+
+// Opt-in hardening for loaded Linux hosts: SCHED_FIFO for the audio thread
+// (through rtkit when the process isn't allowed it directly), CPU pinning for
+// the audio and DSP worker threads, mlockall, and pre-faulted buffers and
+// stack. Every step's outcome goes to the log and getReport().
+//
+// The audio-thread steps are single syscalls made from the first callback
+// after a device start; rtkit is a D-Bus call, so that fallback is left to
+// a helper thread, which also turns the audio thread's results into report
+// lines. Other platforms report the steps as unsupported.
+class RealtimeTuning : private juce::Thread
+{
+public:
+    struct Options
+    {
+        bool enabled = false;
+        int priority = 70;              // SCHED_FIFO, 1..99
+        juce::Array<int> audioCores;    // empty = leave the affinity alone
+        juce::Array<int> workerCores;
+        bool lockMemory = true;
+        
+        // --rt enables; --rt-priority=N, --rt-audio-cores=2,3,
+        // --rt-worker-cores=0,1 and --rt-no-mlock refine it.
+        bool parseCommandLine(const juce::String& commandLine);
+    };
+    
+    RealtimeTuning();
+    ~RealtimeTuning() override;
+    
+    // Before the device is opened.
+    void setOptions(const Options& newOptions);
+    bool isEnabled() const { return options.enabled; }
+    
+    // Not for the audio thread. Locking can be repeated, e.g. after a plugin
+    // has mapped more memory, when only current pages could be locked.
+    void lockMemory();
+    void pinWorkerThread(juce::Thread::ThreadID thread, const juce::String& name);
+    
+    // Writes every page of a freshly allocated buffer so the callback
+    // doesn't take the faults.
+    void prefault(juce::AudioBuffer<float>& buffer);
+    
+    // Arms the audio-thread steps for the next callback (device start).
+    void deviceStarting()
+    {
+        if (!options.enabled)
+            return;
+        prefaultedBytes.store(0);
+        audioThreadPending.store(true);
+    }
+    
+    // First thing in the callback.
+    void onAudioThread() noexcept
+    {
+        if (audioThreadPending.load(std::memory_order_relaxed))
+            tuneAudioThread();
+    }
+    
+    juce::StringArray getReport() const;
+    
+private:
+    void run() override;
+    void tuneAudioThread() noexcept;
+    void addReport(const juce::String& line);
+    bool requestRealtimeFromRtkit(int threadId, int& priority, juce::String& error);
+    
+    static juce::uint64 toMask(const juce::Array<int>& cores);
+    static juce::String describeCores(const juce::Array<int>& cores);
+    
+    Options options;
+    juce::uint64 audioCoreMask = 0;
+    juce::uint64 workerCoreMask = 0;
+    bool lockedFuture = false;
+    std::atomic<juce::int64> prefaultedBytes { 0 };
+    
+    // Audio thread -> helper thread.
+    std::atomic<bool> audioThreadPending { false };
+    std::atomic<bool> audioThreadTuned { false };
+    std::atomic<int> audioThreadId { 0 };
+    std::atomic<int> schedulingResult { 0 };   // 0 or an errno value
+    std::atomic<int> affinityResult { 0 };
+    
+    mutable juce::CriticalSection reportLock;
+    juce::StringArray report;
+};
@@ -0,0 +1,285 @@
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <cmath>
+#include <iostream>
+#include "AudioEngine.h"
+
+// MicBoosterRenderTest: renders a stimulus through the engine on the
+// virtual device, free-running, and compares the recording with a
+// reference render. Run by CTest for every stimulus, rate and block size.
+// The references are recorded from the engine itself with
+// --write-reference (the MicBoosterRenderReferences target); a missing one
+// makes the test report as skipped rather than passed.
+//
+// --stimulus=burst is the silent-input benchmark instead: nothing is
+// recorded or compared, and the run fails if the device measured silent
+// blocks costing more than --max-silent-ratio times active ones per sample.
+//
+// --net-receive=<port> with --net-send=127.0.0.1:<port> is the network
+// loopback test: the engine streams its output to itself in real time, and
+// the run fails unless the receiver lost no packets and measured an
+// end-to-end latency under --max-latency-ms.
+//
+//   MicBoosterRenderTest --stimulus=impulse|sweep|noise --rate=48000 --block=480
+//                        --reference=<file.wav> --output=<file.wav>
+//                        [--tolerance-db=-60] [--settle-ms=50]
+//                        [--write-reference --seconds=<s>]
+//   MicBoosterRenderTest --stimulus=burst [--rate=48000] [--block=256]
+//                        [--seconds=10] [--max-silent-ratio=1.5]
+//   MicBoosterRenderTest --stimulus=noise --net-send=127.0.0.1:<port> --net-receive=<port>
+//                        [--seconds=5] [--max-latency-ms=50]
+namespace
+{
+    // The chain every reference is rendered with; re-record the references
+    // after changing it. Everything else stays at its default.
+    struct Chain
+    {
+        float boostDb, bassDb, midDb, trebleDb;
+    };
+    
+    constexpr Chain referenceChain { -6.0f, 6.0f, -3.0f, 4.0f };
+    
+    // CTest's SKIP_RETURN_CODE for the render tests.
+    constexpr int skipped = 77;
+    
+    std::unique_ptr<juce::AudioFormatReader> openWav(const juce::File& file)
+    {
+        auto stream = file.createInputStream();
+        if (stream == nullptr)
+            return nullptr;
+        
+        juce::WavAudioFormat wav;
+        return std::unique_ptr<juce::AudioFormatReader>(wav.createReaderFor(stream.release(), true));
+    }
+    
+    bool writeMonoWav(const juce::File& file, const juce::AudioBuffer<float>& buffer, double sampleRate)
+    {
+        file.deleteFile();
+        std::unique_ptr<juce::OutputStream> stream = file.createOutputStream();
+        juce::WavAudioFormat wav;
+        
+        std::unique_ptr<juce::AudioFormatWriter> writer(stream != nullptr
+            ? wav.createWriterFor(stream.get(), sampleRate, 1, 24, {}, 0)
+            : nullptr);
+        if (writer == nullptr)
+            return false;
+        
+        stream.release();
+        return writer->writeFromAudioSampleBuffer(buffer, 0, buffer.getNumSamples());
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ArgumentList args(argc, argv);
+    const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    
+    auto option = [&args](const char* name, double fallback)
+    {
+        auto value = args.getValueForOption(name);
+        return value.isNotEmpty() ? value.getDoubleValue() : fallback;
+    };
+    
+    VirtualAudioIODeviceType::Options device;
+    const auto stimulus = args.getValueForOption("--stimulus");
+    if (stimulus == "impulse")    device.generator = VirtualAudioIODeviceType::Options::Generator::impulse;
+    else if (stimulus == "sweep") device.generator = VirtualAudioIODeviceType::Options::Generator::sweep;
+    else if (stimulus == "noise") device.generator = VirtualAudioIODeviceType::Options::Generator::noise;
+    else if (stimulus == "burst") device.generator = VirtualAudioIODeviceType::Options::Generator::burst;
+    else
+    {
+        std::cerr << "--stimulus must be impulse, sweep, noise or burst" << std::endl;
+        return 2;
+    }
+    const bool silenceBenchmark = stimulus == "burst";
+    const int networkPort = args.getValueForOption("--net-receive").getIntValue();
+    const bool networkLoopback = networkPort > 0;
+    
+    RtpAudioSender::Options networkOutput;
+    if (networkLoopback && !networkOutput.parseCommandLine(juce::StringArray(argv + 1, argc - 1).joinIntoString(" ")))
+    {
+        std::cerr << "--net-receive needs --net-send=host:port" << std::endl;
+        return 2;
+    }
+    
+    const auto cwd = juce::File::getCurrentWorkingDirectory();
+    const auto referenceFile = cwd.getChildFile(args.getValueForOption("--reference"));
+    const auto outputFile = cwd.getChildFile(args.getValueForOption("--output"));
+    const bool writeReference = args.containsOption("--write-reference");
+    
+    device.sampleRate = option("--rate", 48000.0);
+    device.bufferSize = (int)option("--block", 256.0);
+    // The receiver plays out in real time, so the loopback can't free-run.
+    device.pace = networkLoopback ? 1.0 : 0.0;
+    device.outputFile = silenceBenchmark || networkLoopback ? juce::File() : outputFile;
+    device.maxSilentCostRatio = option("--max-silent-ratio", device.maxSilentCostRatio);
+    
+    // Render exactly as much as the reference holds.
+    juce::int64 length = 0;
+    if (silenceBenchmark)
+        length = (juce::int64)(option("--seconds", 10.0) * device.sampleRate);
+    else if (networkLoopback)
+        length = (juce::int64)(option("--seconds", 5.0) * device.sampleRate);
+    else if (auto reference = openWav(referenceFile))
+    {
+        if (reference->sampleRate != device.sampleRate)
+        {
+            std::cerr << referenceFile.getFullPathName() << " is at " << reference->sampleRate << " Hz" << std::endl;
+            return 1;
+        }
+        length = reference->lengthInSamples;
+    }
+    if (writeReference)
+        length = (juce::int64)(option("--seconds", 1.0) * device.sampleRate);
+    if (length <= 0)
+    {
+        std::cerr << "No reference " << referenceFile.getFullPathName()
+                  << "; build MicBoosterRenderReferences to record it" << std::endl;
+        return referenceFile.existsAsFile() ? 1 : skipped;
+    }
+    device.durationSeconds = ((double)length + 0.5) / device.sampleRate;
+    if (!silenceBenchmark && !networkLoopback)
+        outputFile.getParentDirectory().createDirectory();
+    
+    juce::WaitableEvent finished;
+    bool passed = false;
+    device.onFinished = [&finished, &passed](bool devicePassed)
+    {
+        passed = devicePassed;
+        finished.signal();
+    };
+    
+    AudioEngine engine;
+    engine.useVirtualDevice(device);
+    engine.setBoostGain(referenceChain.boostDb);
+    engine.setBassGain(referenceChain.bassDb);
+    engine.setMidGain(referenceChain.midDb);
+    engine.setTrebleGain(referenceChain.trebleDb);
+    
+    if (networkLoopback)
+    {
+        engine.setNetworkOutput(networkOutput);
+        if (!engine.setNetworkInput(networkPort))
+        {
+            std::cerr << "Couldn't bind UDP port " << networkPort << std::endl;
+            return 1;
+        }
+    }
+    
+    juce::AudioDeviceManager::AudioDeviceSetup setup;
+    setup.sampleRate = device.sampleRate;
+    setup.bufferSize = device.bufferSize;
+    
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+    engine.initialize(&setup);
+    const bool completed = finished.wait(60000);
+    const double renderSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    
+    // Taken while both ends are still running.
+    const auto sent = engine.getNetworkOutputStats();
+    const auto received = engine.getNetworkInputStats();
+    
+    // Closing the device flushes the recording.
+    engine.shutdown();
+    
+    if (!completed)
+    {
+        std::cerr << "Render didn't finish within a minute" << std::endl;
+        return 1;
+    }
+    
+    // The device has logged the silent and active costs.
+    if (silenceBenchmark)
+    {
+        std::cout << "burst @ " << (int)device.sampleRate << " Hz, block " << device.bufferSize << ": silent input "
+                  << (passed ? "costs about what active input does" : "is too slow, check for denormals") << std::endl;
+        return passed ? 0 : 1;
+    }
+    
+    if (networkLoopback)
+    {
+        const double maxLatencyMs = option("--max-latency-ms", 50.0);
+        std::cout << "loopback @ " << (int)device.sampleRate << " Hz, block " << device.bufferSize << ": "
+                  << sent.packetsSent << " sent, " << received.packetsReceived << " received, "
+                  << received.packetsLost << " lost, " << received.underruns << " underruns, latency "
+                  << juce::String(received.latencyMs, 1) << " ms (limit " << juce::String(maxLatencyMs, 1) << " ms)" << std::endl;
+        
+        if (received.packetsReceived == 0)
+        {
+            std::cerr << "Nothing arrived on port " << networkPort << std::endl;
+            return 1;
+        }
+        if (received.packetsLost != 0)
+        {
+            std::cerr << received.packetsLost << " packets lost over loopback" << std::endl;
+            return 1;
+        }
+        if (received.latencyMs <= 0.0f || received.latencyMs > maxLatencyMs)
+        {
+            std::cerr << "End-to-end latency " << (received.latencyMs <= 0.0f ? "was never measured" : "is over the limit") << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    
+    auto output = openWav(outputFile);
+    if (output == nullptr || output->lengthInSamples < length)
+    {
+        std::cerr << "Render " << outputFile.getFullPathName() << " is missing or short" << std::endl;
+        return 1;
+    }
+    
+    juce::AudioBuffer<float> rendered((int)output->numChannels, (int)length);
+    output->read(&rendered, 0, (int)length, 0, true, true);
+    
+    const double audioSeconds = (double)length / device.sampleRate;
+    std::cout << stimulus << " @ " << (int)device.sampleRate << " Hz, block " << device.bufferSize << ": "
+              << juce::String(audioSeconds, 2) << " s rendered in " << juce::String(renderSeconds * 1000.0, 1)
+              << " ms (" << juce::String(audioSeconds / renderSeconds, 1) << "x real time)" << std::endl;
+    
+    if (writeReference)
+    {
+        juce::AudioBuffer<float> mono(1, (int)length);
+        mono.copyFrom(0, 0, rendered, 0, 0, (int)length);
+        referenceFile.getParentDirectory().createDirectory();
+        if (!writeMonoWav(referenceFile, mono, device.sampleRate))
+        {
+            std::cerr << "Couldn't write " << referenceFile.getFullPathName() << std::endl;
+            return 1;
+        }
+        std::cout << "Wrote " << referenceFile.getFullPathName() << std::endl;
+        return 0;
+    }
+    
+    juce::AudioBuffer<float> expected(1, (int)length);
+    openWav(referenceFile)->read(&expected, 0, (int)length, 0, true, false);
+    
+    // The device fades in over its first block, which the references don't
+    // model; by the end of the settle time the EQ has forgotten it.
+    const int settle = juce::jmin((int)length, (int)(option("--settle-ms", 50.0) * 0.001 * device.sampleRate));
+    const float tolerance = juce::Decibels::decibelsToGain((float)option("--tolerance-db", -60.0));
+    
+    float worstError = 0.0f;
+    int worstChannel = 0, worstSample = settle;
+    for (int ch = 0; ch < rendered.getNumChannels(); ++ch)
+    {
+        const float* actual = rendered.getReadPointer(ch);
+        const float* reference = expected.getReadPointer(0);
+        
+        for (int i = settle; i < (int)length; ++i)
+        {
+            const float error = std::abs(actual[i] - reference[i]);
+            if (error > worstError)
+            {
+                worstError = error;
+                worstChannel = ch;
+                worstSample = i;
+            }
+        }
+    }
+    
+    std::cout << "Max error " << juce::String(juce::Decibels::gainToDecibels(worstError, -200.0f), 1)
+              << " dBFS (channel " << worstChannel + 1 << ", " << juce::String(worstSample / device.sampleRate, 4)
+              << " s), tolerance " << juce::String(juce::Decibels::gainToDecibels(tolerance), 1) << " dBFS" << std::endl;
+    
+    return worstError <= tolerance ? 0 : 1;
+}
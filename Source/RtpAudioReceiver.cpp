@@ -0,0 +1,295 @@
+#include "RtpAudioReceiver.h"
+#include <cmath>
+
+RtpAudioReceiver::RtpAudioReceiver() : Thread("RtpAudioReceiver")
+{
+}
+
+RtpAudioReceiver::~RtpAudioReceiver()
+{
+    stop();
+}
+
+bool RtpAudioReceiver::start(int port, double newSampleRate)
+{
+    stop();
+    sampleRate.store(newSampleRate);
+    
+    socket = std::make_unique<juce::DatagramSocket>();
+    if (!socket->bindToPort(port))
+    {
+        juce::Logger::writeToLog("[net] rx: can't bind UDP port " + juce::String(port));
+        socket.reset();
+        return false;
+    }
+    
+    haveStream = false;
+    startThread(juce::Thread::Priority::high);
+    juce::Logger::writeToLog("[net] rx listening on UDP port " + juce::String(port));
+    return true;
+}
+
+void RtpAudioReceiver::stop()
+{
+    if (socket != nullptr)
+        socket->shutdown();
+    stopThread(2000);
+    socket.reset();
+}
+
+void RtpAudioReceiver::run()
+{
+    juce::HeapBlock<juce::uint8> buffer(Rtp::maxPacketSize + 64);
+    auto lastStatsMs = juce::Time::getMillisecondCounterHiRes();
+    juce::int64 lastPackets = 0;
+    
+    while (!threadShouldExit())
+    {
+        if (socket->waitUntilReady(true, 20) == 1)
+        {
+            const int size = socket->read(buffer.get(), Rtp::maxPacketSize + 64, false);
+            if (size > 0)
+                receivePacket(buffer.get(), size);
+        }
+        
+        const auto nowMs = juce::Time::getMillisecondCounterHiRes();
+        if (nowMs - lastStatsMs >= statsIntervalMs)
+        {
+            const auto stats = getStats();
+            const auto received = stats.packetsReceived - lastPackets;
+            const auto expected = stats.packetsReceived + stats.packetsLost;
+            juce::Logger::writeToLog(juce::String::formatted(
+                "[net] rx %lld packets in %.1f s, lost %lld (%.2f%%), late %lld, dropped %lld, underruns %lld, "
+                "jitter %.2f ms, buffer %.1f/%.1f ms, latency %.1f ms",
+                (long long)received, (nowMs - lastStatsMs) * 0.001, (long long)stats.packetsLost,
+                expected > 0 ? 100.0 * (double)stats.packetsLost / (double)expected : 0.0,
+                (long long)stats.packetsLate, (long long)stats.packetsDropped, (long long)stats.underruns,
+                stats.jitterMs, stats.bufferMs, stats.targetMs, stats.latencyMs));
+            lastStatsMs = nowMs;
+            lastPackets = stats.packetsReceived;
+        }
+    }
+}
+
+void RtpAudioReceiver::receivePacket(const juce::uint8* data, int size)
+{
+    Rtp::Header header;
+    if (!Rtp::parseHeader(data, size, header))
+        return;
+    
+    Rtp::Encoding encoding;
+    if (header.payloadType == Rtp::payloadTypeL16)      encoding = Rtp::Encoding::l16;
+    else if (header.payloadType == Rtp::payloadTypeL24) encoding = Rtp::Encoding::l24;
+    else return;
+    
+    const int frames = (size - header.payloadOffset) / (Rtp::numChannels * Rtp::bytesPerSample(encoding));
+    if (frames <= 0 || frames > maxSlotFrames)
+        return;
+    
+    // A new SSRC is a restarted sender: continue the extended sequence far
+    // enough on that no slot still holds one of its numbers.
+    const bool newStream = !haveStream || header.ssrc != streamSsrc;
+    if (newStream)
+    {
+        sequenceBase = highestReceived + numSlots + 1 - header.sequence;
+        highestReceived = sequenceBase + header.sequence - 1;
+        streamSsrc = header.ssrc;
+        haveStream = true;
+        haveArrival = false;
+        jitterSamples = 0.0;
+    }
+    
+    // Unwrap the 16-bit sequence around the highest one seen so far.
+    const auto highestLow = (juce::uint16)(highestReceived - sequenceBase);
+    const juce::int64 sequence = highestReceived + (juce::int16)(juce::uint16)(header.sequence - highestLow);
+    
+    const auto next = nextSequence.load();
+    if (next >= 0 && sequence < next)
+    {
+        packetsLate.fetch_add(1);
+        return;
+    }
+    if (next >= 0 && sequence >= next + numSlots)
+    {
+        packetsDropped.fetch_add(1);
+        return;
+    }
+    
+    auto& slot = slots[(size_t)(sequence % numSlots)];
+    if (slot.sequence.load() == sequence)
+        return;   // duplicate
+    
+    slot.sequence.store(-1);
+    Rtp::decode(data + header.payloadOffset, frames * Rtp::numChannels, encoding, slot.samples.data());
+    slot.numFrames = frames;
+    slot.captureMicros = header.captureMicros;
+    slot.sequence.store(sequence, std::memory_order_release);
+    
+    packetsReceived.fetch_add(1);
+    packetFrames.store(frames);
+    if (sequence > highestReceived)
+    {
+        highestReceived = sequence;
+        latestSequence.store(sequence, std::memory_order_release);
+    }
+    
+    // After latestSequence, so the audio thread re-anchors on the new numbers.
+    if (newStream)
+        streamGeneration.fetch_add(1);
+    
+    updateJitter(header.timestamp);
+    jitterTargetFrames.store(2 * frames + (int)std::ceil(3.0 * jitterSamples));
+}
+
+void RtpAudioReceiver::updateJitter(juce::uint32 rtpTimestamp)
+{
+    // RFC 3550 interarrival jitter, in samples.
+    const double rate = sampleRate.load();
+    const double arrival = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks()) * rate;
+    if (haveArrival)
+    {
+        const double difference = (arrival - lastArrivalSamples) - (double)(juce::int32)(rtpTimestamp - lastTimestamp);
+        jitterSamples += (std::abs(difference) - jitterSamples) / 16.0;
+        jitterMs.store((float)(1000.0 * jitterSamples / rate));
+    }
+    lastArrivalSamples = arrival;
+    lastTimestamp = rtpTimestamp;
+    haveArrival = true;
+}
+
+void RtpAudioReceiver::pull(float* const* dest, int numChannels, int numSamples) noexcept
+{
+    for (int ch = 0; ch < numChannels; ++ch)
+        juce::FloatVectorOperations::clear(dest[ch], numSamples);
+    
+    const int frames = packetFrames.load();
+    if (frames == 0)
+        return;
+    
+    const double rate = sampleRate.load(std::memory_order_relaxed);
+    
+    const int generation = streamGeneration.load();
+    if (generation != seenGeneration)
+    {
+        seenGeneration = generation;
+        playing = false;
+        nextSequence.store(-1);
+    }
+    
+    auto next = nextSequence.load();
+    const auto latest = latestSequence.load(std::memory_order_acquire);
+    const int target = juce::jmin((numSlots / 2) * frames, jitterTargetFrames.load() + extraTargetFrames);
+    auto depth = [&] { return next < 0 ? 0 : (int)((latest - next + 1) * frames) - readPosition; };
+    
+    targetMs.store((float)(1000.0 * target / rate));
+    bufferMs.store((float)(1000.0 * juce::jmax(0, depth()) / rate));
+    
+    // Relax the underrun allowance once things have been steady for a while.
+    samplesSinceUnderrun += numSamples;
+    if (extraTargetFrames > 0 && samplesSinceUnderrun > (juce::int64)(10.0 * rate))
+    {
+        extraTargetFrames = juce::jmax(0, extraTargetFrames - frames);
+        samplesSinceUnderrun = 0;
+    }
+    
+    if (!playing)
+    {
+        // (Re)buffer from the newest packet until the target depth builds up.
+        if (next < 0 || next > latest + 1 || latest - next >= numSlots)
+        {
+            next = latest;
+            readPosition = 0;
+            nextSequence.store(next);
+        }
+        if (depth() < target)
+            return;
+        playing = true;
+        slackSamples = 0;
+    }
+    
+    // More than two packets over the target for a while: skip one.
+    slackSamples = depth() > target + 2 * frames ? slackSamples + numSamples : 0;
+    if (slackSamples > (juce::int64)(slackTrimSeconds * rate))
+    {
+        trimPending = true;
+        slackSamples = 0;
+    }
+    
+    for (int pos = 0; pos < numSamples;)
+    {
+        if (concealRemaining > 0)
+        {
+            const int n = juce::jmin(concealRemaining, numSamples - pos);
+            concealRemaining -= n;
+            pos += n;
+            continue;
+        }
+        
+        auto& slot = slots[(size_t)(next % numSlots)];
+        if (slot.sequence.load(std::memory_order_acquire) == next)
+        {
+            if (readPosition == 0)
+            {
+                if (trimPending)
+                {
+                    trimPending = false;
+                    packetsDropped.fetch_add(1);
+                    nextSequence.store(++next);
+                    continue;
+                }
+                
+                if (slot.captureMicros > 0)
+                    latencyMs.store((float)((Rtp::nowMicros() - slot.captureMicros) * 0.001));
+            }
+            
+            const int n = juce::jmin(slot.numFrames - readPosition, numSamples - pos);
+            const float* src = slot.samples.data() + readPosition * Rtp::numChannels;
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                const int streamChannel = ch % Rtp::numChannels;
+                for (int i = 0; i < n; ++i)
+                    dest[ch][pos + i] = src[i * Rtp::numChannels + streamChannel];
+            }
+            
+            pos += n;
+            readPosition += n;
+            if (readPosition >= slot.numFrames)
+            {
+                readPosition = 0;
+                nextSequence.store(++next);
+            }
+        }
+        else if (latestSequence.load(std::memory_order_acquire) > next)
+        {
+            // Later packets are here, so this one is lost: play silence for it.
+            packetsLost.fetch_add(1);
+            concealRemaining = frames;
+            readPosition = 0;
+            nextSequence.store(++next);
+        }
+        else
+        {
+            // Ran dry: rebuffer, a packet deeper than before.
+            underruns.fetch_add(1);
+            playing = false;
+            extraTargetFrames = juce::jmin((numSlots / 4) * frames, extraTargetFrames + frames);
+            samplesSinceUnderrun = 0;
+            return;
+        }
+    }
+}
+
+RtpAudioReceiver::Stats RtpAudioReceiver::getStats() const
+{
+    Stats stats;
+    stats.packetsReceived = packetsReceived.load();
+    stats.packetsLost = packetsLost.load();
+    stats.packetsLate = packetsLate.load();
+    stats.packetsDropped = packetsDropped.load();
+    stats.underruns = underruns.load();
+    stats.jitterMs = jitterMs.load();
+    stats.targetMs = targetMs.load();
+    stats.bufferMs = bufferMs.load();
+    stats.latencyMs = latencyMs.load();
+    return stats;
+}
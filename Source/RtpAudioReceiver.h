@@ -0,0 +1,109 @@
+#pragma once
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <atomic>
+#include "RtpPacket.h"
+
+// Receives an RtpAudioSender stream into an adaptive jitter buffer and plays
+// it out from the audio thread. A network thread decodes each packet into a
+// slot picked by its sequence number; the audio thread reads the slots in
+// order, with no locks between them. The target depth follows the measured
+// interarrival jitter (RFC 3550), raised after every underrun and trimmed
+// one packet at a time while there has been slack for a while.
+//
+// Both ends must run at the same sample rate; there is no resampling.
+// Loss, lateness, jitter, buffer depth and end-to-end latency (capture to
+// playout, valid when both ends share a clock, e.g. over loopback) are
+// logged every few seconds and available from getStats().
+class RtpAudioReceiver : private juce::Thread
+{
+public:
+    struct Stats
+    {
+        juce::int64 packetsReceived = 0;
+        juce::int64 packetsLost = 0;       // concealed with silence
+        juce::int64 packetsLate = 0;       // arrived after their playout time
+        juce::int64 packetsDropped = 0;    // buffer full, or trimmed to cut latency
+        juce::int64 underruns = 0;
+        float jitterMs = 0.0f;
+        float targetMs = 0.0f;
+        float bufferMs = 0.0f;
+        float latencyMs = 0.0f;            // 0 until measured
+    };
+    
+    RtpAudioReceiver();
+    ~RtpAudioReceiver() override;
+    
+    // Binds the port and starts receiving; false if the port is taken.
+    // Neither may run while the audio thread is in pull().
+    bool start(int port, double sampleRate);
+    void stop();
+    
+    // Follows a device rate change without touching the socket or thread.
+    void setSampleRate(double newSampleRate) { sampleRate.store(newSampleRate); }
+    bool isReceiving() const { return isThreadRunning(); }
+    
+    // Audio thread: fills numChannels (stream channels repeat across them).
+    void pull(float* const* dest, int numChannels, int numSamples) noexcept;
+    
+    Stats getStats() const;
+    
+private:
+    void run() override;
+    void receivePacket(const juce::uint8* data, int size);
+    void updateJitter(juce::uint32 rtpTimestamp);
+    
+    static constexpr int numSlots = 128;
+    static constexpr int maxSlotFrames = 384;   // >= Rtp::maxFramesPerPacket(l16)
+    static constexpr double statsIntervalMs = 5000.0;
+    static constexpr double slackTrimSeconds = 2.0;
+    
+    struct Slot
+    {
+        std::atomic<juce::int64> sequence { -1 };   // extended; -1 while written
+        int numFrames = 0;
+        juce::int64 captureMicros = 0;
+        std::array<float, maxSlotFrames * Rtp::numChannels> samples {};
+    };
+    
+    std::array<Slot, numSlots> slots;
+    std::unique_ptr<juce::DatagramSocket> socket;
+    std::atomic<double> sampleRate { 48000.0 };
+    
+    // Network thread.
+    juce::uint32 streamSsrc = 0;
+    bool haveStream = false;
+    juce::int64 highestReceived = -1;
+    juce::int64 sequenceBase = 0;
+    double jitterSamples = 0.0;
+    double lastArrivalSamples = 0.0;
+    juce::uint32 lastTimestamp = 0;
+    bool haveArrival = false;
+    
+    // Network thread -> audio thread.
+    std::atomic<juce::int64> latestSequence { -1 };
+    std::atomic<int> packetFrames { 0 };
+    std::atomic<int> jitterTargetFrames { 0 };
+    std::atomic<int> streamGeneration { 0 };   // bumped when the sender restarts
+    
+    // Audio thread.
+    std::atomic<juce::int64> nextSequence { -1 };   // read by the network thread
+    int seenGeneration = 0;
+    bool playing = false;
+    bool trimPending = false;
+    int readPosition = 0;
+    int concealRemaining = 0;
+    int extraTargetFrames = 0;
+    juce::int64 samplesSinceUnderrun = 0;
+    juce::int64 slackSamples = 0;
+    
+    std::atomic<juce::int64> packetsReceived { 0 };
+    std::atomic<juce::int64> packetsLost { 0 };
+    std::atomic<juce::int64> packetsLate { 0 };
+    std::atomic<juce::int64> packetsDropped { 0 };
+    std::atomic<juce::int64> underruns { 0 };
+    std::atomic<float> jitterMs { 0.0f };
+    std::atomic<float> targetMs { 0.0f };
+    std::atomic<float> bufferMs { 0.0f };
+    std::atomic<float> latencyMs { 0.0f };
+};
@@ -0,0 +1,170 @@
+#include "RtpAudioSender.h"
+
+bool RtpAudioSender::Options::parseCommandLine(const juce::String& commandLine)
+{
+    juce::ArgumentList args("MicBooster", commandLine);
+    const auto destination = args.getValueForOption("--net-send");
+    if (destination.isEmpty())
+        return false;
+    
+    host = destination.upToLastOccurrenceOf(":", false, false);
+    if (destination.containsChar(':'))
+        port = destination.fromLastOccurrenceOf(":", false, false).getIntValue();
+    if (host.isEmpty() || !juce::isPositiveAndBelow(port, 65536))
+        return false;
+    
+    encoding = args.getValueForOption("--net-encoding") == "l24" ? Rtp::Encoding::l24 : Rtp::Encoding::l16;
+    const auto packetArg = args.getValueForOption("--net-packet-ms");
+    if (packetArg.isNotEmpty())
+        packetMs = juce::jlimit(1.0, 20.0, packetArg.getDoubleValue());
+    return true;
+}
+
+//==============================================================================
+RtpAudioSender::RtpAudioSender() : Thread("RtpAudioSender")
+{
+    ssrc = (juce::uint32)juce::Random::getSystemRandom().nextInt();
+}
+
+RtpAudioSender::~RtpAudioSender()
+{
+    stopThread(2000);
+}
+
+void RtpAudioSender::setOptions(const Options& newOptions)
+{
+    stopThread(2000);
+    options = newOptions;
+    
+    if (sampleRate > 0.0)
+        prepare(sampleRate);
+}
+
+void RtpAudioSender::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    if (!isEnabled())
+        return;
+    
+    stopThread(2000);
+    
+    // Packets never exceed the MTU, whatever the rate and duration asked for.
+    framesPerPacket = juce::jlimit(1, Rtp::maxFramesPerPacket(options.encoding),
+                                   juce::roundToInt(options.packetMs * 0.001 * sampleRate));
+    
+    const int capacity = juce::jmax(4 * framesPerPacket, (int)(fifoSeconds * sampleRate));
+    fifo.setTotalSize(capacity);
+    fifo.reset();
+    ring.assign((size_t)capacity * Rtp::numChannels, 0.0f);
+    packetFrames.assign((size_t)framesPerPacket * Rtp::numChannels, 0.0f);
+    packet.assign((size_t)Rtp::maxPacketSize, 0);
+    
+    startThread(juce::Thread::Priority::high);
+}
+
+void RtpAudioSender::push(const juce::AudioBuffer<float>& buffer, int numSamples) noexcept
+{
+    if (!isThreadRunning())
+        return;
+    
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+    if (size1 + size2 < numSamples)
+        overflowFrames.fetch_add(numSamples - size1 - size2, std::memory_order_relaxed);
+    
+    // A mono chain feeds both channels of the stream.
+    const float* left = buffer.getReadPointer(0);
+    const float* right = buffer.getReadPointer(buffer.getNumChannels() > 1 ? 1 : 0);
+    
+    auto interleave = [&](int ringStart, int sourceStart, int count)
+    {
+        float* dest = ring.data() + (size_t)ringStart * Rtp::numChannels;
+        for (int i = 0; i < count; ++i)
+        {
+            dest[2 * i] = left[sourceStart + i];
+            dest[2 * i + 1] = right[sourceStart + i];
+        }
+    };
+    
+    interleave(start1, 0, size1);
+    interleave(start2, size1, size2);
+    fifo.finishedWrite(size1 + size2);
+}
+
+void RtpAudioSender::run()
+{
+    juce::DatagramSocket socket;
+    auto lastStatsMs = juce::Time::getMillisecondCounterHiRes();
+    juce::int64 lastPackets = 0;
+    
+    while (!threadShouldExit())
+    {
+        // Polled rather than signalled, so the audio thread never wakes us.
+        wait(1);
+        
+        while (fifo.getNumReady() >= framesPerPacket && !threadShouldExit())
+        {
+            // The newest frame was pushed at most a poll ago, so the packet's
+            // first frame was captured about this long before now.
+            const auto queuedMicros = (juce::int64)(fifo.getNumReady() * 1.0e6 / sampleRate);
+            sendPacket(socket, framesPerPacket, Rtp::nowMicros() - queuedMicros);
+        }
+        
+        const auto nowMs = juce::Time::getMillisecondCounterHiRes();
+        if (nowMs - lastStatsMs >= statsIntervalMs)
+        {
+            const auto stats = getStats();
+            juce::Logger::writeToLog("[net] tx " + options.host + ":" + juce::String(options.port) + " "
+                                     + juce::String(stats.packetsSent - lastPackets) + " packets in "
+                                     + juce::String((nowMs - lastStatsMs) * 0.001, 1) + " s, "
+                                     + juce::String(stats.sendErrors) + " send errors, "
+                                     + juce::String(stats.overflowFrames) + " frames dropped");
+            lastStatsMs = nowMs;
+            lastPackets = stats.packetsSent;
+        }
+    }
+}
+
+void RtpAudioSender::sendPacket(juce::DatagramSocket& socket, int numFrames, juce::int64 captureMicros)
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(numFrames, start1, size1, start2, size2);
+    std::copy(ring.begin() + start1 * Rtp::numChannels, ring.begin() + (start1 + size1) * Rtp::numChannels,
+              packetFrames.begin());
+    std::copy(ring.begin() + start2 * Rtp::numChannels, ring.begin() + (start2 + size2) * Rtp::numChannels,
+              packetFrames.begin() + size1 * Rtp::numChannels);
+    fifo.finishedRead(size1 + size2);
+    
+    Rtp::Header header;
+    header.payloadType = options.encoding == Rtp::Encoding::l16 ? Rtp::payloadTypeL16 : Rtp::payloadTypeL24;
+    header.sequence = sequence++;
+    header.timestamp = timestamp;
+    header.ssrc = ssrc;
+    header.captureMicros = captureMicros;
+    timestamp += (juce::uint32)numFrames;
+    
+    const int offset = Rtp::writeHeader(packet.data(), header);
+    const int numValues = numFrames * Rtp::numChannels;
+    Rtp::encode(packetFrames.data(), numValues, options.encoding, packet.data() + offset);
+    
+    const int size = offset + numValues * Rtp::bytesPerSample(options.encoding);
+    if (socket.write(options.host, options.port, packet.data(), size) == size)
+    {
+        packetsSent.fetch_add(1);
+        bytesSent.fetch_add(size);
+    }
+    else
+    {
+        sendErrors.fetch_add(1);
+    }
+}
+
+RtpAudioSender::Stats RtpAudioSender::getStats() const
+{
+    Stats stats;
+    stats.packetsSent = packetsSent.load();
+    stats.bytesSent = bytesSent.load();
+    stats.sendErrors = sendErrors.load();
+    stats.overflowFrames = overflowFrames.load();
+    return stats;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <atomic>
+#include <vector>
+#include "RtpPacket.h"
+
+// Streams the processed mic to another machine as RTP over UDP. The audio
+// thread only copies each block (first two channels) into a lock-free FIFO;
+// a sender thread cuts it into packets of a fixed duration, encodes L16 or
+// L24 and sends them, stamping each with its capture time. Sent/overflow
+// counts are logged every few seconds and available from getStats().
+class RtpAudioSender : private juce::Thread
+{
+public:
+    struct Options
+    {
+        juce::String host;                 // empty = disabled
+        int port = 5004;
+        Rtp::Encoding encoding = Rtp::Encoding::l16;
+        double packetMs = 5.0;             // shorter = lower latency, more packets
+        
+        // --net-send=host:port, refined by --net-encoding=l16|l24 and
+        // --net-packet-ms=5.
+        bool parseCommandLine(const juce::String& commandLine);
+    };
+    
+    struct Stats
+    {
+        juce::int64 packetsSent = 0;
+        juce::int64 bytesSent = 0;
+        juce::int64 sendErrors = 0;
+        juce::int64 overflowFrames = 0;    // dropped because the sender fell behind
+    };
+    
+    RtpAudioSender();
+    ~RtpAudioSender() override;
+    
+    // These reallocate the FIFO: the owner must make sure push() isn't
+    // running meanwhile (AudioEngine holds it off around them).
+    void setOptions(const Options& newOptions);
+    bool isEnabled() const { return options.host.isNotEmpty(); }
+    
+    // Not on the audio thread; restarts the sender for the new rate.
+    void prepare(double sampleRate);
+    
+    // Audio thread.
+    void push(const juce::AudioBuffer<float>& buffer, int numSamples) noexcept;
+    
+    Stats getStats() const;
+    
+private:
+    void run() override;
+    void sendPacket(juce::DatagramSocket& socket, int numFrames, juce::int64 captureMicros);
+    
+    static constexpr double fifoSeconds = 0.5;
+    static constexpr double statsIntervalMs = 5000.0;
+    
+    Options options;
+    double sampleRate = 0.0;
+    int framesPerPacket = 0;
+    
+    juce::AbstractFifo fifo { 1 };
+    std::vector<float> ring;               // interleaved stereo frames
+    std::vector<float> packetFrames;
+    std::vector<juce::uint8> packet;
+    
+    juce::uint16 sequence = 0;
+    juce::uint32 timestamp = 0;
+    juce::uint32 ssrc = 0;
+    
+    std::atomic<juce::int64> packetsSent { 0 };
+    std::atomic<juce::int64> bytesSent { 0 };
+    std::atomic<juce::int64> sendErrors { 0 };
+    std::atomic<juce::int64> overflowFrames { 0 };
+};
@@ -0,0 +1,152 @@
+#pragma once
+#include <juce_core/juce_core.h>
+
+// RTP framing shared by RtpAudioSender and RtpAudioReceiver: the fixed
+// RFC 3550 header, big-endian L16 (RFC 3551) or L24 (RFC 3190) stereo
+// payloads, and a one-byte header extension (RFC 8285) carrying the capture
+// time, so a receiver on the same clock can measure end-to-end latency.
+namespace Rtp
+{
+    enum class Encoding { l16 = 0, l24 };
+    
+    constexpr int numChannels = 2;
+    constexpr int headerSize = 12;
+    constexpr int extensionSize = 16;          // profile + length, element, padding
+    constexpr int maxPacketSize = 1472;        // fits an Ethernet MTU unfragmented
+    constexpr int maxPayloadSize = maxPacketSize - headerSize - extensionSize;
+    constexpr juce::uint8 payloadTypeL16 = 96; // dynamic types, as in the SDP
+    constexpr juce::uint8 payloadTypeL24 = 97;
+    constexpr juce::uint8 captureTimeExtensionId = 1;
+    
+    inline int bytesPerSample(Encoding encoding) { return encoding == Encoding::l16 ? 2 : 3; }
+    
+    inline int maxFramesPerPacket(Encoding encoding)
+    {
+        return maxPayloadSize / (numChannels * bytesPerSample(encoding));
+    }
+    
+    // Microseconds on the local high-resolution clock.
+    inline juce::int64 nowMicros()
+    {
+        return (juce::int64)(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks()) * 1.0e6);
+    }
+    
+    struct Header
+    {
+        juce::uint8 payloadType = payloadTypeL16;
+        juce::uint16 sequence = 0;
+        juce::uint32 timestamp = 0;
+        juce::uint32 ssrc = 0;
+        juce::int64 captureMicros = 0;         // 0 when the extension is absent
+        int payloadOffset = 0;                 // set by parseHeader
+    };
+    
+    // Writes the header and capture-time extension; returns the payload offset.
+    inline int writeHeader(juce::uint8* dest, const Header& header)
+    {
+        dest[0] = 0x80 | 0x10;                 // version 2, extension bit
+        dest[1] = header.payloadType & 0x7f;
+        juce::ByteOrder::writeBigEndianShort(header.sequence, dest + 2);
+        juce::ByteOrder::writeBigEndianInt(header.timestamp, dest + 4);
+        juce::ByteOrder::writeBigEndianInt(header.ssrc, dest + 8);
+        
+        auto* ext = dest + headerSize;
+        juce::ByteOrder::writeBigEndianShort(0xbede, ext);
+        juce::ByteOrder::writeBigEndianShort((extensionSize - 4) / 4, ext + 2);
+        ext[4] = (juce::uint8)((captureTimeExtensionId << 4) | (8 - 1));
+        juce::ByteOrder::writeBigEndianInt((juce::uint32)((juce::uint64)header.captureMicros >> 32), ext + 5);
+        juce::ByteOrder::writeBigEndianInt((juce::uint32)header.captureMicros, ext + 9);
+        ext[13] = ext[14] = ext[15] = 0;
+        
+        return headerSize + extensionSize;
+    }
+    
+    // Validates and reads a packet's header; unknown extensions are skipped.
+    inline bool parseHeader(const juce::uint8* data, int size, Header& header)
+    {
+        if (size < headerSize || (data[0] >> 6) != 2)
+            return false;
+        
+        const int csrcCount = data[0] & 0x0f;
+        int offset = headerSize + 4 * csrcCount;
+        
+        header.payloadType = data[1] & 0x7f;
+        header.sequence = juce::ByteOrder::bigEndianShort(data + 2);
+        header.timestamp = juce::ByteOrder::bigEndianInt(data + 4);
+        header.ssrc = juce::ByteOrder::bigEndianInt(data + 8);
+        header.captureMicros = 0;
+        
+        if ((data[0] & 0x10) != 0)
+        {
+            if (size < offset + 4)
+                return false;
+            
+            const int profile = juce::ByteOrder::bigEndianShort(data + offset);
+            const int length = 4 * juce::ByteOrder::bigEndianShort(data + offset + 2);
+            const int end = offset + 4 + length;
+            if (size < end)
+                return false;
+            
+            for (int i = offset + 4; profile == 0xbede && i < end;)
+            {
+                if (data[i] == 0) { ++i; continue; }   // padding
+                
+                const int id = data[i] >> 4;
+                const int elementSize = (data[i] & 0x0f) + 1;
+                if (id == 15 || i + 1 + elementSize > end)
+                    break;
+                
+                if (id == captureTimeExtensionId && elementSize == 8)
+                    header.captureMicros = (juce::int64)(((juce::uint64)juce::ByteOrder::bigEndianInt(data + i + 1) << 32)
+                                                         | juce::ByteOrder::bigEndianInt(data + i + 5));
+                i += 1 + elementSize;
+            }
+            offset = end;
+        }
+        
+        // Trailing padding (P bit): the last byte says how much.
+        if ((data[0] & 0x20) != 0 && size > offset)
+            size -= data[size - 1];
+        
+        header.payloadOffset = offset;
+        return size >= offset;
+    }
+    
+    inline void encode(const float* interleaved, int numValues, Encoding encoding, juce::uint8* dest)
+    {
+        if (encoding == Encoding::l16)
+        {
+            for (int i = 0; i < numValues; ++i)
+            {
+                const auto value = (juce::int16)juce::roundToInt(juce::jlimit(-1.0f, 1.0f, interleaved[i]) * 32767.0f);
+                juce::ByteOrder::writeBigEndianShort((juce::uint16)value, dest + 2 * i);
+            }
+            return;
+        }
+        
+        for (int i = 0; i < numValues; ++i)
+        {
+            const auto value = juce::roundToInt(juce::jlimit(-1.0f, 1.0f, interleaved[i]) * 8388607.0f);
+            dest[3 * i] = (juce::uint8)(value >> 16);
+            dest[3 * i + 1] = (juce::uint8)(value >> 8);
+            dest[3 * i + 2] = (juce::uint8)value;
+        }
+    }
+    
+    inline void decode(const juce::uint8* src, int numValues, Encoding encoding, float* interleaved)
+    {
+        if (encoding == Encoding::l16)
+        {
+            for (int i = 0; i < numValues; ++i)
+                interleaved[i] = (float)(juce::int16)juce::ByteOrder::bigEndianShort(src + 2 * i) * (1.0f / 32768.0f);
+            return;
+        }
+        
+        for (int i = 0; i < numValues; ++i)
+        {
+            const auto value = (juce::int32)(((juce::uint32)src[3 * i] << 24) | ((juce::uint32)src[3 * i + 1] << 16)
+                                             | ((juce::uint32)src[3 * i + 2] << 8)) >> 8;
+            interleaved[i] = (float)value * (1.0f / 8388608.0f);
+        }
+    }
+}
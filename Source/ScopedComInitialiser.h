@@ -0,0 +1,39 @@
+#pragma once
+
+#ifdef _WIN32
+#include <objbase.h>
+#endif
+
+// COM for the lifetime of a worker thread that enumerates or opens audio
+// devices; WASAPI and DirectSound need it on the calling thread. These
+// helpers do nothing on other platforms.
+struct ScopedComInitialiser
+{
+#ifdef _WIN32
+    ScopedComInitialiser() : initialised(SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED))) {}
+    ~ScopedComInitialiser() { if (initialised) CoUninitialize(); }
+    
+    ScopedComInitialiser(const ScopedComInitialiser&) = delete;
+    ScopedComInitialiser& operator=(const ScopedComInitialiser&) = delete;
+    
+private:
+    const bool initialised;
+#endif
+};
+
+// Keeps the multithreaded apartment alive while held, so COM objects
+// created on a short-lived MTA thread (a device opened by the engine's
+// init thread) stay valid after that thread has exited.
+struct ScopedMtaUsage
+{
+#ifdef _WIN32
+    ScopedMtaUsage() { if (FAILED(CoIncrementMTAUsage(&cookie))) cookie = nullptr; }
+    ~ScopedMtaUsage() { if (cookie != nullptr) CoDecrementMTAUsage(cookie); }
+    
+    ScopedMtaUsage(const ScopedMtaUsage&) = delete;
+    ScopedMtaUsage& operator=(const ScopedMtaUsage&) = delete;
+    
+private:
+    CO_MTA_USAGE_COOKIE cookie = nullptr;
+#endif
+};
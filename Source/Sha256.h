@@ -0,0 +1,26 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <array>
+#include <cstdint>
+
+// Incremental SHA-256 (FIPS 180-4), so a download can be hashed as it
+// streams instead of being read back afterwards.
+class Sha256
+{
+public:
+    Sha256() { reset(); }
+    
+    void reset();
+    void update(const void* data, size_t numBytes);
+    
+    // Finalises and returns the lowercase hex digest; call reset() to reuse.
+    juce::String finishHex();
+    
+private:
+    void processBlock(const uint8_t* block);
+    
+    std::array<uint32_t, 8> state {};
+    std::array<uint8_t, 64> buffer {};
+    size_t bufferUsed = 0;
+    uint64_t totalBytes = 0;
+};
@@ -0,0 +1,91 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+// Layout of the live metrics segment the engine publishes (see
+// MetricsPublisher), plus the seqlock both sides use. It has no JUCE
+// dependency so monitoring agents can include it as it is: map the file
+// read-only, cast it to Segment and call read() as often as you like. A
+// read is two loads and a copy; it never blocks the writer and never makes
+// a syscall.
+//
+// The audio thread is the only writer. It makes the sequence odd, writes
+// the values and makes it even again; a reader that sees the same even
+// sequence before and after its copy has a consistent snapshot.
+namespace SharedMetrics
+{
+    constexpr std::uint32_t magic = 0x544d424d;   // "MBMT"
+    constexpr std::uint32_t version = 1;
+    
+    struct Values
+    {
+        std::uint64_t callbacks = 0;
+        std::uint64_t samplesProcessed = 0;        // at the device rate
+        double sampleRate = 0.0;
+        std::int32_t blockSize = 0;                // last callback
+        std::int32_t numChannels = 0;              // channels in the chain
+        
+        // Peaks of the last callback (linear, 1.0 = full scale) and loudness.
+        float inputPeak = 0.0f;
+        float outputPeak = 0.0f;
+        float shortTermLufs = -100.0f;
+        float integratedLufs = -100.0f;
+        
+        // Gain changes, in dB (reductions are negative). The boost is the
+        // one applied, whether set by hand or by auto level.
+        float boostDb = 0.0f;
+        float duckingDb = 0.0f;
+        float clipperReductionDb = 0.0f;
+        
+        // Callback time against the block's duration (1.0 = deadline).
+        float callbackMs = 0.0f;
+        float callbackLoad = 0.0f;
+        float peakCallbackLoad = 0.0f;             // since publishing started
+        std::uint32_t overruns = 0;                // callbacks over the deadline
+        std::uint32_t deviceXruns = 0;             // as reported by the driver
+        std::uint32_t shedStages = 0;              // by the overload governor
+        std::uint32_t reserved = 0;
+    };
+    
+    struct Segment
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint32_t size;                        // sizeof(Segment)
+        std::atomic<std::uint32_t> sequence;
+        Values values;
+    };
+    
+    static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "the seqlock must work across processes");
+    
+    // Writer side, single thread only.
+    inline void write(Segment& segment, const Values& values) noexcept
+    {
+        const auto sequence = segment.sequence.load(std::memory_order_relaxed);
+        segment.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&segment.values, &values, sizeof(Values));
+        segment.sequence.store(sequence + 2, std::memory_order_release);
+    }
+    
+    // False if the segment isn't ours or the writer kept racing the copy.
+    inline bool read(const Segment& segment, Values& values, int maxAttempts = 100) noexcept
+    {
+        if (segment.magic != magic || segment.version != version || segment.size != sizeof(Segment))
+            return false;
+        
+        for (int attempt = 0; attempt < maxAttempts; ++attempt)
+        {
+            const auto before = segment.sequence.load(std::memory_order_acquire);
+            if ((before & 1) != 0)
+                continue;
+            
+            std::memcpy(&values, &segment.values, sizeof(Values));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (segment.sequence.load(std::memory_order_relaxed) == before)
+                return true;
+        }
+        return false;
+    }
+}
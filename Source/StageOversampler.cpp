@@ -0,0 +1,66 @@
+#include "StageOversampler.h"
+
+void StageOversampler::prepare(int numChannels, int maxBlockSize)
+{
+    for (int f = 0; f < numFactors; ++f)
+    {
+        for (int type = 0; type < 2; ++type)
+        {
+            auto filterType = type == (int)Filter::polyphaseIIR
+                ? juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR
+                : juce::dsp::Oversampling<float>::filterHalfBandFIREquiripple;
+            
+            auto os = std::make_unique<juce::dsp::Oversampling<float>>(
+                (size_t)juce::jmax(1, numChannels), (size_t)(f + 1), filterType, true, true);
+            os->initProcessing((size_t)maxBlockSize);
+            latencies[(size_t)(f * 2 + type)].store(juce::roundToInt(os->getLatencyInSamples()));
+            oversamplers[(size_t)(f * 2 + type)] = std::move(os);
+        }
+    }
+    
+    inUse = nullptr;
+    publishLatency();
+}
+
+void StageOversampler::reset()
+{
+    for (auto& os : oversamplers)
+        if (os != nullptr)
+            os->reset();
+}
+
+juce::dsp::Oversampling<float>* StageOversampler::getActive() const
+{
+    const int f = factor.load();
+    if (f == (int)Factor::off)
+        return nullptr;
+    
+    return oversamplers[(size_t)((f - 1) * 2 + filter.load())].get();
+}
+
+void StageOversampler::publishLatency()
+{
+    const int f = factor.load();
+    latency.store(f == (int)Factor::off ? 0 : latencies[(size_t)((f - 1) * 2 + filter.load())].load());
+}
+
+juce::dsp::AudioBlock<float> StageOversampler::processUp(juce::dsp::AudioBlock<float> block)
+{
+    auto* os = getActive();
+    
+    // A freshly engaged oversampler starts from clean filter state.
+    if (os != inUse && os != nullptr)
+        os->reset();
+    inUse = os;
+    
+    if (inUse == nullptr)
+        return block;
+    
+    return inUse->processSamplesUp(block);
+}
+
+void StageOversampler::processDown(juce::dsp::AudioBlock<float> block)
+{
+    if (inUse != nullptr)
+        inUse->processSamplesDown(block);
+}
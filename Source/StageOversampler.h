@@ -0,0 +1,50 @@
+#pragma once
+#include <juce_dsp/juce_dsp.h>
+#include <array>
+#include <atomic>
+
+// Runs one nonlinear stage at 2x/4x/8x. Every factor/filter combination is
+// built in prepare(), so switching between them on the audio thread is just
+// an index change; when the factor is off (or the wrapped stage is bypassed)
+// nothing is up- or down-sampled.
+class StageOversampler
+{
+public:
+    enum class Factor { off = 0, x2, x4, x8 };
+    enum class Filter { polyphaseIIR = 0, equirippleFIR };
+    
+    void prepare(int numChannels, int maxBlockSize);
+    void reset();
+    
+    void setFactor(Factor newFactor) { factor.store((int)newFactor); publishLatency(); }
+    void setFilter(Filter newFilter) { filter.store((int)newFilter); publishLatency(); }
+    Factor getFactor() const { return (Factor)factor.load(); }
+    Filter getFilter() const { return (Filter)filter.load(); }
+    int getRatio() const { return 1 << factor.load(); }
+    
+    // Latency at the base rate for the currently selected configuration.
+    // Safe from any thread: it never touches the oversamplers, which
+    // prepare() rebuilds on the device thread.
+    int getLatencySamples() const { return latency.load(); }
+    
+    // Upsamples into an internal buffer and returns it; call processDown()
+    // with the original block once the stage has run. Returns the input
+    // block unchanged when oversampling is off.
+    juce::dsp::AudioBlock<float> processUp(juce::dsp::AudioBlock<float> block);
+    void processDown(juce::dsp::AudioBlock<float> block);
+    
+private:
+    juce::dsp::Oversampling<float>* getActive() const;
+    void publishLatency();
+    
+    static constexpr int numFactors = 3;
+    std::array<std::unique_ptr<juce::dsp::Oversampling<float>>, numFactors * 2> oversamplers;
+    
+    std::atomic<int> factor { (int)Factor::off };
+    std::atomic<int> filter { (int)Filter::polyphaseIIR };
+    
+    // Per factor/filter, filled in prepare(); latency is the selected one.
+    std::array<std::atomic<int>, numFactors * 2> latencies {};
+    std::atomic<int> latency { 0 };
+    juce::dsp::Oversampling<float>* inUse = nullptr;
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <algorithm>
+#include <vector>
+
+// Startup milestones, relative to construction, written to the JUCE log in
+// time order once the last one is in. Message thread only; milestones
+// measured elsewhere are passed in with their own timestamp.
+class StartupTrace
+{
+public:
+    StartupTrace() : startMs(juce::Time::getMillisecondCounterHiRes()) {}
+    
+    void mark(const juce::String& stage)
+    {
+        mark(stage, juce::Time::getMillisecondCounterHiRes());
+    }
+    
+    void mark(const juce::String& stage, double timeMs)
+    {
+        if (!finished)
+            milestones.push_back({ timeMs - startMs, stage });
+    }
+    
+    void finish()
+    {
+        if (finished)
+            return;
+        finished = true;
+        
+        std::sort(milestones.begin(), milestones.end(),
+                  [](const Milestone& a, const Milestone& b) { return a.ms < b.ms; });
+        
+        juce::String report = "Startup trace:";
+        for (auto& m : milestones)
+            report << juce::newLine << juce::String(m.ms, 1).paddedLeft(' ', 8) << " ms  " << m.stage;
+        juce::Logger::writeToLog(report);
+    }
+    
+    bool isFinished() const { return finished; }
+    
+private:
+    struct Milestone
+    {
+        double ms;
+        juce::String stage;
+    };
+    
+    double startMs;
+    std::vector<Milestone> milestones;
+    bool finished = false;
+};
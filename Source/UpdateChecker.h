@@ -2,6 +2,7 @@
 #include <juce_core/juce_core.h>
 #include <juce_events/juce_events.h>
 #include <juce_gui_basics/juce_gui_basics.h>
+#include "UpdateDownloader.h"
 
 class UpdateChecker : private juce::Thread
 {
@@ -15,12 +16,14 @@ public:
         juce::String version;
         juce::String downloadUrl;
         juce::String releaseNotes;
+        juce::String sha256;
     };
     
     UpdateChecker() : Thread("UpdateChecker") {}
     
     ~UpdateChecker()
     {
+        downloader.cancel();
         stopThread(5000);
     }
     
@@ -39,52 +42,42 @@ public:
     
     std::function<void(const UpdateInfo&)> onUpdateFound;
     
-    void downloadUpdate(const juce::String& url)
+    // Downloads and verifies the update, then swaps it in and restarts.
+    // Progress and failures are reported on the message thread.
+    void downloadUpdate(const UpdateInfo& info)
     {
-        auto tempDir = juce::File::getSpecialLocation(juce::File::tempDirectory);
-        auto tempExe = tempDir.getChildFile("MicBooster_update.exe");
-        auto currentExe = juce::File::getSpecialLocation(juce::File::currentExecutableFile);
-        
-        juce::URL downloadUrl(url);
-        auto stream = downloadUrl.createInputStream(juce::URL::InputStreamOptions(juce::URL::ParameterHandling::inAddress)
-            .withConnectionTimeoutMs(30000));
-        
-        if (stream == nullptr)
-            return;
-        
-        tempExe.deleteFile();
-        juce::FileOutputStream fos(tempExe);
-        if (!fos.openedOk())
-            return;
+        auto tempExe = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("MicBooster_update.exe");
         
-        char buffer[8192];
-        while (!stream->isExhausted())
+        downloader.onProgress = [this](juce::int64 done, juce::int64 total)
         {
-            auto bytesRead = stream->read(buffer, sizeof(buffer));
-            if (bytesRead <= 0) break;
-            fos.write(buffer, (size_t)bytesRead);
-        }
-        fos.flush();
+            if (onDownloadProgress)
+                onDownloadProgress(done, total);
+        };
         
-        auto batFile = tempDir.getChildFile("micbooster_update.bat");
-        batFile.replaceWithText(
-            "@echo off\r\n"
-            "timeout /t 2 /nobreak >nul\r\n"
-            "copy /y \"" + tempExe.getFullPathName() + "\" \"" + currentExe.getFullPathName() + "\"\r\n"
-            "start \"\" \"" + currentExe.getFullPathName() + "\"\r\n"
-            "del \"" + tempExe.getFullPathName() + "\"\r\n"
-            "del \"%~f0\"\r\n"
-        );
+        downloader.onFinished = [this, tempExe](bool ok, const juce::String& error)
+        {
+            if (ok)
+                installAndRestart(tempExe);
+            else if (onDownloadFailed)
+                onDownloadFailed(error);
+        };
         
-        batFile.startAsProcess();
-        juce::JUCEApplication::getInstance()->systemRequestedQuit();
+        downloader.start(info.downloadUrl, info.sha256, tempExe);
     }
     
+    bool isDownloading() const { return downloader.isDownloading(); }
+    
+    std::function<void(juce::int64 bytesDone, juce::int64 bytesTotal)> onDownloadProgress;
+    std::function<void(const juce::String& error)> onDownloadFailed;
+    
+    // Points the checker at another release endpoint, e.g. a local server
+    // standing in for GitHub. Call before checkForUpdates().
+    void setApiUrl(const juce::String& url) { apiUrl = url; }
+    
 private:
     void run() override
     {
-        juce::URL apiUrl(GITHUB_API_URL);
-        auto stream = apiUrl.createInputStream(juce::URL::InputStreamOptions(juce::URL::ParameterHandling::inAddress)
+        auto stream = juce::URL(apiUrl).createInputStream(juce::URL::InputStreamOptions(juce::URL::ParameterHandling::inAddress)
             .withConnectionTimeoutMs(10000)
             .withExtraHeaders("Accept: application/vnd.github.v3+json\r\nUser-Agent: MicBooster"));
         
@@ -101,7 +94,7 @@ private:
         auto body = json.getProperty("body", "").toString();
         
         auto assets = json.getProperty("assets", juce::var());
-        juce::String downloadUrl;
+        juce::String downloadUrl, exeName, digestUrl;
         
         if (assets.isArray())
         {
@@ -109,14 +102,31 @@ private:
             {
                 auto asset = assets[i];
                 auto name = asset.getProperty("name", "").toString().toLowerCase();
-                if (name.endsWith(".exe"))
+                if (name.endsWith(".exe") && downloadUrl.isEmpty())
                 {
+                    exeName = name;
                     downloadUrl = asset.getProperty("browser_download_url", "").toString();
-                    break;
+                }
+                else if (name.endsWith(".sha256") || name.startsWith("sha256sums"))
+                {
+                    digestUrl = asset.getProperty("browser_download_url", "").toString();
                 }
             }
         }
         
+        // The digest comes from a .sha256 / SHA256SUMS asset, or failing that
+        // a "SHA-256: <hex>" line in the release notes.
+        juce::String sha256;
+        if (digestUrl.isNotEmpty())
+        {
+            if (auto digestStream = juce::URL(digestUrl).createInputStream(juce::URL::InputStreamOptions(juce::URL::ParameterHandling::inAddress)
+                    .withConnectionTimeoutMs(10000)
+                    .withExtraHeaders("User-Agent: MicBooster")))
+                sha256 = findDigest(digestStream->readEntireStreamAsString(), exeName);
+        }
+        if (sha256.isEmpty())
+            sha256 = findDigest(body, exeName);
+        
         if (tagName.isNotEmpty() && isNewerVersion(tagName))
         {
             UpdateInfo info;
@@ -124,6 +134,7 @@ private:
             info.version = tagName;
             info.downloadUrl = downloadUrl;
             info.releaseNotes = body;
+            info.sha256 = sha256;
             
             {
                 juce::ScopedLock lock(infoLock);
@@ -141,6 +152,43 @@ private:
         }
     }
     
+    // First 64-digit hex token, preferring a line that names the asset.
+    static juce::String findDigest(const juce::String& text, const juce::String& assetName)
+    {
+        juce::String firstFound;
+        for (auto& line : juce::StringArray::fromLines(text))
+        {
+            for (auto& token : juce::StringArray::fromTokens(line, " \t*:`", ""))
+            {
+                if (token.length() == 64 && token.containsOnly("0123456789abcdefABCDEF"))
+                {
+                    if (assetName.isNotEmpty() && line.toLowerCase().contains(assetName))
+                        return token.toLowerCase();
+                    if (firstFound.isEmpty())
+                        firstFound = token.toLowerCase();
+                }
+            }
+        }
+        return firstFound;
+    }
+    
+    void installAndRestart(const juce::File& tempExe)
+    {
+        auto currentExe = juce::File::getSpecialLocation(juce::File::currentExecutableFile);
+        auto batFile = tempExe.getSiblingFile("micbooster_update.bat");
+        batFile.replaceWithText(
+            "@echo off\r\n"
+            "timeout /t 2 /nobreak >nul\r\n"
+            "copy /y \"" + tempExe.getFullPathName() + "\" \"" + currentExe.getFullPathName() + "\"\r\n"
+            "start \"\" \"" + currentExe.getFullPathName() + "\"\r\n"
+            "del \"" + tempExe.getFullPathName() + "\"\r\n"
+            "del \"%~f0\"\r\n"
+        );
+        
+        batFile.startAsProcess();
+        juce::JUCEApplication::getInstance()->systemRequestedQuit();
+    }
+    
     bool isNewerVersion(const juce::String& remoteVersion)
     {
         auto current = juce::StringArray::fromTokens(CURRENT_VERSION, ".", "");
@@ -158,4 +206,6 @@ private:
     
     mutable juce::CriticalSection infoLock;
     UpdateInfo latestInfo;
+    juce::String apiUrl { GITHUB_API_URL };
+    UpdateDownloader downloader;
 };
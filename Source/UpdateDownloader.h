@@ -0,0 +1,277 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+#include "Sha256.h"
+
+// Streams an update to disk on its own thread. Bytes land in "<file>.part"
+// and are hashed as they arrive; an interrupted download is resumed with an
+// HTTP Range request rather than fetched again, and the file is only moved
+// into place once its SHA-256 matches the published digest. Progress and the
+// result are delivered on the message thread.
+class UpdateDownloader : private juce::Thread
+{
+public:
+    UpdateDownloader() : Thread("UpdateDownloader") {}
+    
+    ~UpdateDownloader()
+    {
+        cancel();
+    }
+    
+    // bytesTotal is -1 when the server doesn't report a length.
+    std::function<void(juce::int64 bytesDone, juce::int64 bytesTotal)> onProgress;
+    std::function<void(bool ok, const juce::String& error)> onFinished;
+    
+    void start(const juce::String& url, const juce::String& expectedSha256, const juce::File& destination)
+    {
+        if (isThreadRunning())
+            return;
+        
+        sourceUrl = url;
+        expectedDigest = expectedSha256.trim().toLowerCase();
+        target = destination;
+        startThread(juce::Thread::Priority::low);
+    }
+    
+    // Stops the transfer; the partial file is kept for the next attempt.
+    void cancel()
+    {
+        signalThreadShouldExit();
+        notify();
+        stopThread(5000);
+    }
+    
+    bool isDownloading() const { return isThreadRunning(); }
+    
+private:
+    static constexpr int maxAttempts = 5;
+    static constexpr int minChunk = 16 * 1024;
+    static constexpr int initialChunk = 64 * 1024;
+    static constexpr int maxChunk = 1024 * 1024;
+    
+    void run() override
+    {
+        juce::String error;
+        const bool ok = download(error);
+        
+        juce::MessageManager::callAsync([weakThis = juce::WeakReference<UpdateDownloader>(this), ok, error]
+        {
+            if (weakThis != nullptr && weakThis->onFinished)
+                weakThis->onFinished(ok, error);
+        });
+    }
+    
+    bool download(juce::String& error)
+    {
+        if (expectedDigest.length() != 64)
+        {
+            error = "No published checksum for this update";
+            return false;
+        }
+        
+        // A verified copy from an earlier run needs no network at all.
+        if (target.existsAsFile() && hashFile(target, hasher) == expectedDigest)
+            return true;
+        
+        auto partFile = target.getSiblingFile(target.getFileName() + ".part");
+        auto partInfo = target.getSiblingFile(target.getFileName() + ".partinfo");
+        
+        // Only resume bytes that belong to this exact release.
+        const juce::String identity = sourceUrl + "\n" + expectedDigest;
+        if (partInfo.loadFileAsString() != identity)
+            partFile.deleteFile();
+        partInfo.replaceWithText(identity);
+        
+        juce::int64 bytesDone = 0;
+        hasher.reset();
+        if (partFile.existsAsFile())
+        {
+            if (!rehashPartial(partFile, bytesDone))
+            {
+                error = "Couldn't read the partial download";
+                return false;
+            }
+        }
+        
+        juce::int64 bytesTotal = -1;
+        bool complete = false;
+        
+        for (int attempt = 0; attempt < maxAttempts && !complete; ++attempt)
+        {
+            if (threadShouldExit())
+            {
+                error = "Cancelled";
+                return false;
+            }
+            
+            if (attempt > 0)
+                wait(juce::jmin(30000, 1000 << attempt));
+            
+            complete = transfer(partFile, bytesDone, bytesTotal, error);
+            if (error.isNotEmpty())
+                return false;
+        }
+        
+        if (!complete)
+        {
+            error = "Download interrupted; it will resume from " + juce::File::descriptionOfSizeInBytes(bytesDone);
+            return false;
+        }
+        
+        if (hasher.finishHex() != expectedDigest)
+        {
+            partFile.deleteFile();
+            partInfo.deleteFile();
+            error = "Checksum mismatch; the download was discarded";
+            return false;
+        }
+        
+        target.deleteFile();
+        if (!partFile.moveFileTo(target))
+        {
+            error = "Couldn't move the update into place";
+            return false;
+        }
+        
+        partInfo.deleteFile();
+        return true;
+    }
+    
+    // One HTTP request, resumed from bytesDone. Returns true once the whole
+    // body is on disk; a dropped connection returns false with no error so the
+    // caller retries, while a fatal problem sets error.
+    bool transfer(const juce::File& partFile, juce::int64& bytesDone, juce::int64& bytesTotal, juce::String& error)
+    {
+        juce::String headers = "User-Agent: MicBooster";
+        if (bytesDone > 0)
+            headers << "\r\nRange: bytes=" << bytesDone << "-";
+        
+        int statusCode = 0;
+        auto stream = juce::URL(sourceUrl).createInputStream(juce::URL::InputStreamOptions(juce::URL::ParameterHandling::inAddress)
+            .withConnectionTimeoutMs(30000)
+            .withExtraHeaders(headers)
+            .withStatusCode(&statusCode));
+        
+        if (stream == nullptr)
+            return false;
+        
+        if (statusCode == 416 || (bytesDone > 0 && statusCode == 200))
+        {
+            // The server ignored or rejected the range, so start over.
+            partFile.deleteFile();
+            bytesDone = 0;
+            hasher.reset();
+            if (statusCode == 416)
+                return false;
+        }
+        else if (statusCode >= 400)
+        {
+            error = "Server returned HTTP " + juce::String(statusCode);
+            return false;
+        }
+        
+        const auto remaining = stream->getTotalLength();
+        bytesTotal = remaining >= 0 ? bytesDone + remaining : -1;
+        
+        juce::FileOutputStream out(partFile);
+        if (!out.openedOk())
+        {
+            error = "Couldn't write to " + partFile.getFullPathName();
+            return false;
+        }
+        
+        juce::HeapBlock<char> buffer(maxChunk);
+        int chunkSize = initialChunk;
+        double lastProgressMs = 0.0;
+        
+        while (!threadShouldExit())
+        {
+            const double readStartMs = juce::Time::getMillisecondCounterHiRes();
+            const auto bytesRead = stream->read(buffer.get(), chunkSize);
+            if (bytesRead <= 0)
+                break;
+            
+            if (!out.write(buffer.get(), (size_t)bytesRead))
+            {
+                error = "Couldn't write to " + partFile.getFullPathName();
+                return false;
+            }
+            
+            hasher.update(buffer.get(), (size_t)bytesRead);
+            bytesDone += bytesRead;
+            
+            // Grow the chunk while full reads come back quickly, shrink it when
+            // the link is slow so progress and cancellation stay responsive.
+            const double nowMs = juce::Time::getMillisecondCounterHiRes();
+            const double readMs = nowMs - readStartMs;
+            if (bytesRead == chunkSize && readMs < 50.0)
+                chunkSize = juce::jmin(maxChunk, chunkSize * 2);
+            else if (readMs > 500.0)
+                chunkSize = juce::jmax(minChunk, chunkSize / 2);
+            
+            if (nowMs - lastProgressMs >= 100.0)
+            {
+                lastProgressMs = nowMs;
+                postProgress(bytesDone, bytesTotal);
+            }
+        }
+        
+        out.flush();
+        if (out.getStatus().failed())
+        {
+            error = out.getStatus().getErrorMessage();
+            return false;
+        }
+        
+        postProgress(bytesDone, bytesTotal);
+        
+        if (threadShouldExit())
+            return false;
+        
+        return stream->isExhausted() && (bytesTotal < 0 || bytesDone == bytesTotal);
+    }
+    
+    bool rehashPartial(const juce::File& partFile, juce::int64& bytesDone)
+    {
+        juce::FileInputStream in(partFile);
+        if (!in.openedOk())
+            return false;
+        
+        juce::HeapBlock<char> buffer(initialChunk);
+        for (int n; (n = in.read(buffer.get(), initialChunk)) > 0;)
+        {
+            hasher.update(buffer.get(), (size_t)n);
+            bytesDone += n;
+        }
+        return true;
+    }
+    
+    static juce::String hashFile(const juce::File& file, Sha256& sha)
+    {
+        juce::FileInputStream in(file);
+        if (!in.openedOk())
+            return {};
+        
+        sha.reset();
+        juce::HeapBlock<char> buffer(initialChunk);
+        for (int n; (n = in.read(buffer.get(), initialChunk)) > 0;)
+            sha.update(buffer.get(), (size_t)n);
+        return sha.finishHex();
+    }
+    
+    void postProgress(juce::int64 bytesDone, juce::int64 bytesTotal)
+    {
+        juce::MessageManager::callAsync([weakThis = juce::WeakReference<UpdateDownloader>(this), bytesDone, bytesTotal]
+        {
+            if (weakThis != nullptr && weakThis->onProgress)
+                weakThis->onProgress(bytesDone, bytesTotal);
+        });
+    }
+    
+    juce::String sourceUrl;
+    juce::String expectedDigest;
+    juce::File target;
+    Sha256 hasher;
+    
+    JUCE_DECLARE_WEAK_REFERENCEABLE(UpdateDownloader)
+};
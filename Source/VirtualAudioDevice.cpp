@@ -0,0 +1,382 @@
+#include "VirtualAudioDevice.h"
+#include <chrono>
+#include <thread>
+#include <utility>
+
+bool VirtualAudioIODeviceType::Options::parseCommandLine(const juce::String& commandLine)
+{
+    juce::ArgumentList args("MicBooster", commandLine);
+    if (!args.containsOption("--virtual-device"))
+        return false;
+    
+    auto input = args.getValueForOption("--virtual-input");
+    if (input == "silence")      generator = Generator::silence;
+    else if (input == "sine")    generator = Generator::sine;
+    else if (input == "noise")   generator = Generator::noise;
+    else if (input == "impulse") generator = Generator::impulse;
+    else if (input == "burst")   generator = Generator::burst;
+    else if (input == "sweep")   generator = Generator::sweep;
+    else if (input.isNotEmpty()) inputFile = juce::File::getCurrentWorkingDirectory().getChildFile(input);
+    
+    auto output = args.getValueForOption("--virtual-output");
+    if (output.isNotEmpty())
+        outputFile = juce::File::getCurrentWorkingDirectory().getChildFile(output);
+    
+    auto option = [&args](const char* name, double fallback)
+    {
+        auto value = args.getValueForOption(name);
+        return value.isNotEmpty() ? value.getDoubleValue() : fallback;
+    };
+    
+    sampleRate = juce::jlimit(8000.0, 384000.0, option("--virtual-rate", sampleRate));
+    bufferSize = juce::jlimit(1, 8192, (int)option("--virtual-block", bufferSize));
+    pace = juce::jmax(0.0, option("--virtual-pace", pace));
+    jitterMs = juce::jmax(0.0, option("--virtual-jitter-ms", jitterMs));
+    restartIntervalSeconds = juce::jmax(0.0, option("--virtual-restart-s", restartIntervalSeconds));
+    durationSeconds = juce::jmax(0.0, option("--virtual-duration", durationSeconds));
+    seed = (juce::int64)option("--virtual-seed", (double)seed);
+    maxSilentCostRatio = juce::jmax(1.0, option("--virtual-max-silent-ratio", maxSilentCostRatio));
+    irregularBlocks = args.containsOption("--virtual-irregular-blocks");
+    return true;
+}
+
+//==============================================================================
+VirtualAudioIODeviceType::VirtualAudioIODeviceType(const Options& o)
+    : AudioIODeviceType(typeName), options(o)
+{
+}
+
+juce::StringArray VirtualAudioIODeviceType::getDeviceNames(bool wantInputNames) const
+{
+    return { wantInputNames ? "Virtual Input" : "Virtual Output" };
+}
+
+juce::AudioIODevice* VirtualAudioIODeviceType::createDevice(const juce::String&, const juce::String&)
+{
+    // Accept any name, so settings saved against real hardware still open.
+    return new VirtualAudioIODevice("Virtual Device", options);
+}
+
+//==============================================================================
+VirtualAudioIODevice::VirtualAudioIODevice(const juce::String& deviceName,
+                                           const VirtualAudioIODeviceType::Options& o)
+    : AudioIODevice(deviceName, VirtualAudioIODeviceType::typeName),
+      Thread("VirtualAudioDevice"),
+      options(o)
+{
+}
+
+VirtualAudioIODevice::~VirtualAudioIODevice()
+{
+    close();
+}
+
+juce::Array<double> VirtualAudioIODevice::getAvailableSampleRates()
+{
+    juce::Array<double> rates { 44100.0, 48000.0, 88200.0, 96000.0 };
+    rates.addIfNotAlreadyThere(options.sampleRate);
+    rates.sort();
+    return rates;
+}
+
+juce::Array<int> VirtualAudioIODevice::getAvailableBufferSizes()
+{
+    juce::Array<int> sizes { 32, 64, 128, 256, 512, 1024, 2048 };
+    sizes.addIfNotAlreadyThere(options.bufferSize);
+    sizes.sort();
+    return sizes;
+}
+
+juce::String VirtualAudioIODevice::open(const juce::BigInteger& inputChannels,
+                                        const juce::BigInteger& outputChannels,
+                                        double newSampleRate,
+                                        int bufferSizeSamples)
+{
+    close();
+    
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : options.sampleRate;
+    bufferSize = bufferSizeSamples > 0 ? bufferSizeSamples : options.bufferSize;
+    
+    activeInputs = inputChannels;
+    activeInputs.setRange(numChannels, activeInputs.getHighestBit() + 1, false);
+    activeOutputs = outputChannels;
+    activeOutputs.setRange(numChannels, activeOutputs.getHighestBit() + 1, false);
+    numInputs = activeInputs.countNumberOfSetBits();
+    numOutputs = activeOutputs.countNumberOfSetBits();
+    
+    inputBuffer.setSize(numInputs, bufferSize);
+    outputBuffer.setSize(numOutputs, bufferSize);
+    generatorPhase = 0.0;
+    generatorPosition = 0;
+    readerPosition = 0;
+    xruns.store(0);
+    random.setSeed(options.seed);
+    
+    ioThread.startThread();
+    
+    if (options.inputFile != juce::File())
+    {
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+        
+        if (auto* fileReader = formats.createReaderFor(options.inputFile))
+        {
+            auto buffering = std::make_unique<juce::BufferingAudioReader>(fileReader, ioThread, (int)sampleRate * 2);
+            buffering->setReadTimeout(1000);
+            reader = std::move(buffering);
+        }
+        else
+        {
+            lastError = "Couldn't read " + options.inputFile.getFullPathName();
+            return lastError;
+        }
+    }
+    
+    if (options.outputFile != juce::File() && numOutputs > 0)
+    {
+        options.outputFile.deleteFile();
+        std::unique_ptr<juce::OutputStream> stream = options.outputFile.createOutputStream();
+        juce::WavAudioFormat wav;
+        
+        auto* fileWriter = stream != nullptr
+            ? wav.createWriterFor(stream.get(), sampleRate, (unsigned int)numOutputs, 24, {}, 0)
+            : nullptr;
+        
+        if (fileWriter == nullptr)
+        {
+            lastError = "Couldn't write " + options.outputFile.getFullPathName();
+            return lastError;
+        }
+        
+        stream.release();
+        writer = std::make_unique<juce::AudioFormatWriter::ThreadedWriter>(fileWriter, ioThread, 1 << 17);
+    }
+    
+    opened = true;
+    lastError.clear();
+    return {};
+}
+
+void VirtualAudioIODevice::close()
+{
+    stop();
+    writer.reset();
+    reader.reset();
+    ioThread.stopThread(2000);
+    opened = false;
+}
+
+void VirtualAudioIODevice::start(juce::AudioIODeviceCallback* newCallback)
+{
+    if (!opened || newCallback == nullptr || isThreadRunning())
+        return;
+    
+    callback = newCallback;
+    callback->audioDeviceAboutToStart(this);
+    startThread(juce::Thread::Priority::highest);
+}
+
+void VirtualAudioIODevice::stop()
+{
+    if (isThreadRunning())
+    {
+        signalThreadShouldExit();
+        stopThread(2000);
+    }
+    
+    if (auto* oldCallback = std::exchange(callback, nullptr))
+        oldCallback->audioDeviceStopped();
+}
+
+int VirtualAudioIODevice::nextBlockSize()
+{
+    if (!options.irregularBlocks)
+        return bufferSize;
+    
+    // Odd sizes, and not always full buffers, like some drivers deliver.
+    const int n = random.nextInt({ juce::jmax(1, bufferSize / 4), bufferSize + 1 }) | 1;
+    return juce::jmin(n, bufferSize);
+}
+
+void VirtualAudioIODevice::fillInput(int numSamples)
+{
+    if (numInputs == 0)
+        return;
+    
+    if (reader != nullptr)
+    {
+        // Files are looped and played at the device rate.
+        const auto length = reader->lengthInSamples;
+        if (length <= 0)
+        {
+            inputBuffer.clear(0, numSamples);
+            return;
+        }
+        
+        for (int done = 0; done < numSamples;)
+        {
+            if (readerPosition >= length)
+                readerPosition = 0;
+            
+            const int chunk = (int)juce::jmin((juce::int64)(numSamples - done), length - readerPosition);
+            reader->read(&inputBuffer, done, chunk, readerPosition, true, true);
+            readerPosition += chunk;
+            done += chunk;
+        }
+        return;
+    }
+    
+    auto* data = inputBuffer.getWritePointer(0);
+    const double phaseIncrement = juce::MathConstants<double>::twoPi * 440.0 / sampleRate;
+    const auto impulsePeriod = (juce::int64)sampleRate;
+    const auto burstPeriod = (juce::int64)(5.0 * sampleRate);
+    const auto burstLength = (juce::int64)(0.5 * sampleRate);
+    const auto sweepPeriod = (juce::int64)sampleRate;
+    const double sweepStart = 20.0, sweepEnd = juce::jmin(20000.0, 0.45 * sampleRate);
+    
+    for (int i = 0; i < numSamples; ++i)
+    {
+        switch (options.generator)
+        {
+            case VirtualAudioIODeviceType::Options::Generator::sine:
+                data[i] = 0.25f * (float)std::sin(generatorPhase);
+                generatorPhase = std::fmod(generatorPhase + phaseIncrement, juce::MathConstants<double>::twoPi);
+                break;
+            case VirtualAudioIODeviceType::Options::Generator::noise:
+                data[i] = 0.03f * (random.nextFloat() * 2.0f - 1.0f);
+                break;
+            case VirtualAudioIODeviceType::Options::Generator::impulse:
+                data[i] = (generatorPosition + i) % impulsePeriod == 0 ? 1.0f : 0.0f;
+                break;
+            case VirtualAudioIODeviceType::Options::Generator::burst:
+                data[i] = (generatorPosition + i) % burstPeriod < burstLength ? 0.25f * (float)std::sin(generatorPhase) : 0.0f;
+                generatorPhase = std::fmod(generatorPhase + phaseIncrement, juce::MathConstants<double>::twoPi);
+                break;
+            case VirtualAudioIODeviceType::Options::Generator::sweep:
+            {
+                const auto position = (generatorPosition + i) % sweepPeriod;
+                if (position == 0)
+                    generatorPhase = 0.0;
+                
+                data[i] = 0.25f * (float)std::sin(generatorPhase);
+                const double frequency = sweepStart * std::pow(sweepEnd / sweepStart, (double)position / (double)sweepPeriod);
+                generatorPhase = std::fmod(generatorPhase + juce::MathConstants<double>::twoPi * frequency / sampleRate,
+                                           juce::MathConstants<double>::twoPi);
+                break;
+            }
+            case VirtualAudioIODeviceType::Options::Generator::silence:
+            default:
+                data[i] = 0.0f;
+                break;
+        }
+    }
+    generatorPosition += numSamples;
+    
+    for (int ch = 1; ch < numInputs; ++ch)
+        inputBuffer.copyFrom(ch, 0, inputBuffer, 0, 0, numSamples);
+}
+
+void VirtualAudioIODevice::run()
+{
+    using Clock = std::chrono::steady_clock;
+    auto deadline = Clock::now();
+    juce::int64 samplesSinceRestart = 0;
+    juce::int64 samplesRendered = 0;
+    juce::int64 callbackTicks = 0, maxCallbackTicks = 0;
+    
+    // Cost split by whether the block's input was all zeros. No flush-to-zero
+    // here: like a real driver thread, it leaves that to the callback.
+    juce::int64 silentTicks = 0, silentSamples = 0;
+    const auto durationSamples = (juce::int64)(options.durationSeconds * sampleRate);
+    
+    while (!threadShouldExit())
+    {
+        const int n = nextBlockSize();
+        fillInput(n);
+        outputBuffer.clear(0, n);
+        const bool silentInput = numInputs == 0 || inputBuffer.getMagnitude(0, 0, n) == 0.0f;
+        
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+        callback->audioDeviceIOCallbackWithContext(inputBuffer.getArrayOfReadPointers(), numInputs,
+                                                   outputBuffer.getArrayOfWritePointers(), numOutputs,
+                                                   n, {});
+        const auto elapsedTicks = juce::Time::getHighResolutionTicks() - startTicks;
+        callbackTicks += elapsedTicks;
+        maxCallbackTicks = juce::jmax(maxCallbackTicks, elapsedTicks);
+        if (silentInput)
+        {
+            silentTicks += elapsedTicks;
+            silentSamples += n;
+        }
+        
+        if (writer != nullptr)
+            writer->write(outputBuffer.getArrayOfReadPointers(), n);
+        
+        samplesRendered += n;
+        if (durationSamples > 0 && samplesRendered >= durationSamples)
+        {
+            const double audioSeconds = (double)samplesRendered / sampleRate;
+            const double cpuSeconds = juce::Time::highResolutionTicksToSeconds(callbackTicks);
+            juce::Logger::writeToLog(juce::String::formatted(
+                "Virtual device: %.2f s rendered, %.3f s in callbacks (%.1fx real time), worst callback %.3f ms, %d xruns",
+                audioSeconds, cpuSeconds, cpuSeconds > 0.0 ? audioSeconds / cpuSeconds : 0.0,
+                juce::Time::highResolutionTicksToSeconds(maxCallbackTicks) * 1000.0, xruns.load()));
+            
+            // Silent blocks should cost what active ones do; much more means
+            // something in the chain is grinding through denormals.
+            bool passed = true;
+            const auto activeSamples = samplesRendered - silentSamples;
+            if (silentSamples > 0 && activeSamples > 0)
+            {
+                const double silentUs = juce::Time::highResolutionTicksToSeconds(silentTicks) * 1.0e6 / (double)silentSamples;
+                const double activeUs = juce::Time::highResolutionTicksToSeconds(callbackTicks - silentTicks) * 1.0e6 / (double)activeSamples;
+                const double ratio = activeUs > 0.0 ? silentUs / activeUs : 0.0;
+                passed = ratio <= options.maxSilentCostRatio;
+                juce::Logger::writeToLog(juce::String::formatted(
+                    "Virtual device: silent input %.4f us/sample, active input %.4f us/sample (ratio %.2f, limit %.2f)%s",
+                    silentUs, activeUs, ratio, options.maxSilentCostRatio,
+                    passed ? "" : " - FAILED: silent input is slower, check for denormals"));
+            }
+            
+            // The writer flushes when the device closes.
+            if (options.onFinished)
+                options.onFinished(passed);
+            return;
+        }
+        
+        samplesSinceRestart += n;
+        if (options.restartIntervalSeconds > 0.0
+            && samplesSinceRestart >= (juce::int64)(options.restartIntervalSeconds * sampleRate))
+        {
+            // Same sequence the callback sees when a real driver restarts.
+            callback->audioDeviceStopped();
+            callback->audioDeviceAboutToStart(this);
+            samplesSinceRestart = 0;
+            deadline = Clock::now();
+            continue;
+        }
+        
+        if (options.pace <= 0.0)
+            continue;
+        
+        const auto blockDuration = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(n / (sampleRate * options.pace)));
+        deadline += blockDuration;
+        
+        const auto now = Clock::now();
+        if (now > deadline + blockDuration)
+        {
+            // Fell more than a block behind; count it and resynchronise.
+            ++xruns;
+            deadline = now;
+            continue;
+        }
+        
+        auto wake = deadline;
+        if (options.jitterMs > 0.0)
+            wake += std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double, std::milli>((random.nextDouble() * 2.0 - 1.0) * options.jitterMs));
+        
+        std::this_thread::sleep_until(wake);
+    }
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <juce_audio_devices/juce_audio_devices.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+
+// Hardware-free stand-in for a sound card, for soak and throughput runs on
+// machines without audio devices. Input comes from a file (looped) or a
+// generator, output goes to a WAV file or nowhere, and the callback is
+// driven from a high-priority thread at real-time pace, a multiple of it,
+// or as fast as possible. Jitter, irregular block sizes and periodic
+// restarts can be injected to exercise the engine's edge cases.
+class VirtualAudioIODeviceType : public juce::AudioIODeviceType
+{
+public:
+    static constexpr const char* typeName = "Virtual";
+    
+    struct Options
+    {
+        // burst: half a second of sine every five seconds, so the chain's
+        // filters spend most of the run decaying on silent input. sweep: an
+        // exponential sine sweep from 20 Hz to 20 kHz (or 0.45 x the rate),
+        // restarting every second.
+        enum class Generator { silence = 0, sine, noise, impulse, burst, sweep };
+        
+        juce::File inputFile;               // used instead of the generator when set
+        Generator generator = Generator::sine;
+        juce::File outputFile;              // null sink when empty
+        
+        double sampleRate = 48000.0;
+        int bufferSize = 256;
+        double pace = 1.0;                  // 1 = real time, 0 = free-running
+        double jitterMs = 0.0;              // +/- on each callback's wake-up
+        bool irregularBlocks = false;       // random odd sizes up to bufferSize
+        double restartIntervalSeconds = 0.0;
+        double durationSeconds = 0.0;       // stop after this much audio, 0 = run until closed
+        juce::int64 seed = 1;               // noise, jitter and block sizes are reproducible
+        
+        // A timed run fails when silent input costs more than this per sample
+        // than active input: something in the chain is on denormals.
+        double maxSilentCostRatio = 1.5;
+        
+        // Called on the device thread once durationSeconds has been rendered,
+        // after the timing summary has been logged.
+        std::function<void(bool passed)> onFinished;
+        
+        // Reads --virtual-device and its --virtual-* options; returns false
+        // when the virtual device wasn't asked for.
+        bool parseCommandLine(const juce::String& commandLine);
+    };
+    
+    explicit VirtualAudioIODeviceType(const Options& options);
+    
+    void scanForDevices() override {}
+    juce::StringArray getDeviceNames(bool wantInputNames) const override;
+    int getDefaultDeviceIndex(bool) const override { return 0; }
+    int getIndexOfDevice(juce::AudioIODevice* device, bool) const override { return device != nullptr ? 0 : -1; }
+    bool hasSeparateInputsAndOutputs() const override { return true; }
+    juce::AudioIODevice* createDevice(const juce::String& outputDeviceName,
+                                      const juce::String& inputDeviceName) override;
+    
+private:
+    Options options;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(VirtualAudioIODeviceType)
+};
+
+class VirtualAudioIODevice : public juce::AudioIODevice,
+                             private juce::Thread
+{
+public:
+    static constexpr int numChannels = 2;
+    
+    VirtualAudioIODevice(const juce::String& deviceName, const VirtualAudioIODeviceType::Options& options);
+    ~VirtualAudioIODevice() override;
+    
+    juce::StringArray getOutputChannelNames() override { return { "Out 1", "Out 2" }; }
+    juce::StringArray getInputChannelNames() override { return { "In 1", "In 2" }; }
+    juce::Array<double> getAvailableSampleRates() override;
+    juce::Array<int> getAvailableBufferSizes() override;
+    int getDefaultBufferSize() override { return options.bufferSize; }
+    
+    juce::String open(const juce::BigInteger& inputChannels,
+                      const juce::BigInteger& outputChannels,
+                      double sampleRate,
+                      int bufferSizeSamples) override;
+    void close() override;
+    bool isOpen() override { return opened; }
+    void start(juce::AudioIODeviceCallback* callback) override;
+    void stop() override;
+    bool isPlaying() override { return isThreadRunning(); }
+    juce::String getLastError() override { return lastError; }
+    
+    int getCurrentBufferSizeSamples() override { return bufferSize; }
+    double getCurrentSampleRate() override { return sampleRate; }
+    int getCurrentBitDepth() override { return 32; }
+    juce::BigInteger getActiveOutputChannels() const override { return activeOutputs; }
+    juce::BigInteger getActiveInputChannels() const override { return activeInputs; }
+    int getOutputLatencyInSamples() override { return 0; }
+    int getInputLatencyInSamples() override { return 0; }
+    
+    // Callbacks that started later than one block after their deadline.
+    int getXRunCount() const noexcept override { return xruns.load(); }
+    
+private:
+    void run() override;
+    int nextBlockSize();
+    void fillInput(int numSamples);
+    
+    VirtualAudioIODeviceType::Options options;
+    
+    bool opened = false;
+    juce::String lastError;
+    double sampleRate = 48000.0;
+    int bufferSize = 256;
+    juce::BigInteger activeInputs, activeOutputs;
+    int numInputs = 0, numOutputs = 0;
+    
+    juce::AudioBuffer<float> inputBuffer, outputBuffer;
+    juce::Random random;
+    double generatorPhase = 0.0;
+    juce::int64 generatorPosition = 0;
+    
+    juce::TimeSliceThread ioThread { "VirtualAudioDevice IO" };
+    std::unique_ptr<juce::AudioFormatReader> reader;
+    juce::int64 readerPosition = 0;
+    std::unique_ptr<juce::AudioFormatWriter::ThreadedWriter> writer;
+    
+    juce::AudioIODeviceCallback* callback = nullptr;
+    std::atomic<int> xruns { 0 };
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(VirtualAudioIODevice)
+};